@@ -6,7 +6,35 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <sys/mman.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <float.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#define JSON_IO_URING
+#endif
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
 
 /**
  * Get key count in key_array
@@ -23,16 +51,19 @@ size_t json_key_count(char** key_array) {
     return key_count;
 }
 
+void* json_malloc(json_doc_t* doc, size_t size);
+void json_dealloc(json_doc_t* doc, void* ptr);
+
 /**
  * Frees a char** array
  * @param array Array to free from memory
  */
 void json_free_double_char_array(char** array) {
     for (int i = 0; array[i] != NULL; i++) {
-        free(array[i]);
+        json_dealloc(NULL, array[i]);
     }
 
-    free(array);
+    json_dealloc(NULL, array);
 }
 
 /**
@@ -57,1015 +88,6107 @@ int json_is_invisible(const char c) {
 }
 
 /**
- * Counts number of invisible characters in string
+ * Checks if a character is a quote delimiting a string, that is a quote not escaped by a backslash
+ * (a quote after an escaped backslash, as in "a\\", still closes the string)
  * @param str String pointer
- * @return Number of invisible characters in string
+ * @param i Index of the character to check
+ * @return Boolean value
  */
-size_t json_count_invisible_characters(const char* str) {
-    int spaces = 0;
-    int quotes = 0;
-    for (int i = 0; str[i] != '\0'; i++) {
-        if (str[i] == '\"' && (i == 0 ? 1 : str[i - 1] != '\\')) {
-            quotes++;
-        }
-        if (json_is_invisible(str[i]) && !(quotes % 2)) {
-            spaces++;
-        }
+int json_is_quote(const char* str, size_t i) {
+    size_t backslashes = 0;
+
+    if (str[i] != '\"') {
+        return 0;
     }
 
-    return spaces;
+    while (backslashes < i && str[i - backslashes - 1] == '\\') {
+        backslashes++;
+    }
+
+    return backslashes % 2 == 0;
 }
 
 /**
- * Get contents of an object between first and last braces
- * @param str Serialized JSON object
- * @return Content of object (without containing braces)
+ * Finds the first byte of a string value that can't be copied as is when unescaping: a backslash,
+ * a control character or the start of a multi-byte UTF-8 sequence. Runs on 16 bytes blocks with SSE2.
+ * @param str Raw string value
+ * @param len Length of the string value
+ * @return Index of the byte, len if the whole string can be copied
  */
-char* json_isolate_content(const char *str) {
-    size_t len = strlen(str);
-    char* dest = malloc(len - 1);
+size_t json_scan_unescape(const char* str, size_t len) {
+    size_t i = 0;
 
-    dest[len - 2] = '\0';
-    strncpy(dest, str + 1, len - 2);
+#ifdef __SSE2__
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
 
-    return dest;
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+        /* Signed comparison, bytes >= 0x80 are negative and caught along with the control characters */
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, backslash), _mm_cmplt_epi8(block, space)));
+
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    for (; i < len; i++) {
+        unsigned char c = str[i];
+
+        if (c == '\\' || c < 0x20 || c >= 0x80) {
+            return i;
+        }
+    }
+
+    return len;
 }
 
 /**
- * Gets number of settings in isolated JSON object
- * @param str Isolated json object
- * @return Number of settings in string
+ * Finds the first byte of a string that must be escaped when serializing: a quote, a backslash or a control
+ * character. Runs on 16 bytes blocks with SSE2.
+ * @param str String
+ * @param len Length of the string
+ * @return Index of the byte, len if the whole string can be copied
  */
-size_t json_count_isolated_settings(const char *str) {
-    size_t count = 1;
+size_t json_scan_escape(const char* str, size_t len) {
+    size_t i = 0;
 
-    int quotes = 0;
-    int braces = 0;
-    for (int i = 0; str[i] != '\0'; i++) {
-        if (str[i] == '\"' && (i == 0 ? 1 : str[i - 1] != '\\')) { quotes++; }
-        if (str[i] == '{' && !(quotes % 2)) { braces++; }
-        if (str[i] == '}' && !(quotes % 2)) { braces--; }
-        if (str[i] == ',' && !(quotes % 2) && !braces && str[i+1] == '"') {
-            count++;
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i*)(str + i));
+        /* Unsigned comparison, max(c, 0x1f) == 0x1f only for control characters */
+        __m128i special = _mm_cmpeq_epi8(_mm_max_epu8(block, control), control);
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(block, quote));
+        special = _mm_or_si128(special, _mm_cmpeq_epi8(block, backslash));
+
+        int mask = _mm_movemask_epi8(special);
+
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
         }
     }
+#endif
 
-    return count;
+    for (; i < len; i++) {
+        unsigned char c = str[i];
+
+        if (c == '\"' || c == '\\' || c < 0x20) {
+            return i;
+        }
+    }
+
+    return len;
 }
 
 /**
- * Frees a single setting from memory
- * @param setting Setting object to free
+ * Gets the length of the UTF-8 sequence at the start of a string, rejecting overlong forms, surrogates
+ * and code points above U+10FFFF
+ * @param str String pointer
+ * @param len Number of bytes available
+ * @return Length of the sequence, 0 if it is invalid
  */
-void json_free_setting(json_setting_t *setting) {
-    if (setting == NULL) {
-        return;
+size_t json_utf8_sequence(const unsigned char* str, size_t len) {
+    size_t n;
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xbf;
+
+    if (str[0] < 0x80) {
+        return 1;
+    } else if (str[0] >= 0xc2 && str[0] <= 0xdf) {
+        n = 2;
+    } else if (str[0] >= 0xe0 && str[0] <= 0xef) {
+        n = 3;
+        lo = str[0] == 0xe0 ? 0xa0 : 0x80;
+        hi = str[0] == 0xed ? 0x9f : 0xbf;
+    } else if (str[0] >= 0xf0 && str[0] <= 0xf4) {
+        n = 4;
+        lo = str[0] == 0xf0 ? 0x90 : 0x80;
+        hi = str[0] == 0xf4 ? 0x8f : 0xbf;
+    } else {
+        return 0;
     }
 
-    free(setting->name);
+    if (len < n || str[1] < lo || str[1] > hi) {
+        return 0;
+    }
 
-    if (setting->type == String) {
-        free(setting->string_type);
-    } else if (setting->type == Object && setting->obj_type != NULL) {
-        json_free(setting->obj_type);
+    for (size_t i = 2; i < n; i++) {
+        if (str[i] < 0x80 || str[i] > 0xbf) {
+            return 0;
+        }
     }
 
-    free(setting);
+    return n;
 }
 
 /**
- * Deserializes unique json setting
- * @param string Serialized setting of type "key":"value"
- * @return -1 on error, 0 on success
+ * Reads the 4 hexadecimal digits of a \u escape
+ * @param str Digits
+ * @param len Number of bytes available
+ * @return Code unit, -1 if invalid
  */
-json_setting_t* parse_setting_line(const char *string) {
-    json_setting_t* set = malloc(sizeof(json_setting_t));
-    size_t len = strlen(string);
-    char* str_value;
+long json_hex4(const char* str, size_t len) {
+    long value = 0;
 
-    int found = 0;
-    int quotes = 0;
-    int mallocced = 0;
-    size_t colon = 0;
-    for (size_t i = 0; i < len; i++) {
-        if (string[i] == '\"' && (i == 0 ? 1 : string[i - 1] != '\\')) { quotes++; }
-        if (string[i] == ',' && i == len - 1) {
-            if (mallocced == 1) {
-                free(set->name);
-            }
-            free(set);
-            return NULL;
-        }
-        if (string[i] == ':' && !(quotes % 2) && !found && string[i - 1] == '\"') {
-            found = 1;
-            colon = i;
-            set->name = malloc(i - 1);
-            mallocced = 1;
-            set->name[i - 2] = '\0';
-            strncpy(set->name, &string[1], i - 2);
-        }
-        if (i == len - 1) {
-            str_value = malloc(i - colon + 1);
-            str_value[i - colon] = '\0';
-            strncpy(str_value, &string[colon + 1], i - colon);
-            break;
-        }
+    if (len < 4) {
+        return -1;
     }
 
-    if (str_value[0] == '\"') {
-        size_t len2 = strlen(str_value);
-        set->type = String;
-        set->string_type = malloc(len2 - 1);
-        set->string_type[len2 - 2] = '\0';
-        strncpy(set->string_type, &str_value[1], len2 - 2);
-    } else if (str_value[0] == 't' || str_value[0] == 'f') {
-        set->type = Boolean;
-        set->bool_type = strcmp(str_value, "true") == 0 ? 1 : 0;
-    } else if (str_value[0] == '-' || (str_value[0] >= '0' && str_value[0] <= '9')) {
-        if (strchr(str_value, '.')) {
-            set->type = Floating;
-            set->double_type = strtod(str_value, NULL);
+    for (size_t i = 0; i < 4; i++) {
+        char c = str[i];
+
+        value <<= 4;
+        if (c >= '0' && c <= '9') {
+            value |= c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            value |= c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            value |= c - 'A' + 10;
         } else {
-            set->type = Integer;
-            set->long_type = strtoll(str_value, NULL, 10);
+            return -1;
         }
-    } else if (str_value[0] == '{') {
-        set->type = Object;
-        set->obj_type = json_from_string(str_value);
-    } else if (str_value[0] == 'n') {
-        set->type = Object;
-        set->obj_type = NULL;
-    } else {
-        free(set->name);
-        free(set);
-        free(str_value);
-        return NULL;
     }
 
-    free(str_value);
-    return set;
+    return value;
 }
 
 /**
- * Clears invisible characters in string for further processing
- * @param str Pointer to string to clear
- * @return Cleared string pointer
+ * Encodes a code point in UTF-8
+ * @param dest Destination, at least 4 bytes
+ * @param cp Code point
+ * @return Number of bytes written
  */
-char* json_align(const char* str) {
-    size_t len = strlen(str);
-    size_t spaces = json_count_invisible_characters(str);
-    char *aligned = malloc(len - spaces + 1);
-    aligned[len - spaces] = '\0';
-
-    int j = 0;
-    int quotes = 0;
-    for (int i = 0; str[i] != '\0'; i++) {
-        if (str[i] == '\"' && (i == 0 ? 1 : str[i - 1] != '\\')) { quotes++; }
-        if (json_is_invisible(str[i]) && !(quotes % 2)) { continue; }
-        aligned[j] = str[i];
-        j++;
+size_t json_utf8_encode(char* dest, long cp) {
+    if (cp < 0x80) {
+        dest[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        dest[0] = (char)(0xc0 | (cp >> 6));
+        dest[1] = (char)(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        dest[0] = (char)(0xe0 | (cp >> 12));
+        dest[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        dest[2] = (char)(0x80 | (cp & 0x3f));
+        return 3;
     }
 
-    return aligned;
+    dest[0] = (char)(0xf0 | (cp >> 18));
+    dest[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+    dest[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    dest[3] = (char)(0x80 | (cp & 0x3f));
+    return 4;
 }
 
 /**
- * Extracts strings from a serialized JSON object, each containing one setting of the object
- * @param str Serialized JSON string
- * @return Array of json setting names
+ * Decodes a single escape sequence (after its backslash)
+ * @param str Escape sequence, without the backslash
+ * @param len Number of bytes available
+ * @param dest Destination of the decoded UTF-8 bytes, at least 4 bytes
+ * @param written Set to the number of bytes written to dest
+ * @return Number of bytes consumed from str, 0 if the escape is invalid
  */
-char** json_get_string_settings(const char *str) {
-    char* aligned = json_align(str);
-    size_t len = strlen(aligned);
+size_t json_unescape_sequence(const char* str, size_t len, char* dest, size_t* written) {
+    static const char simple[] = "\"\"\\\\//b\bf\fn\nr\rt\t";
 
-    if (str[0] != '{' || str[len - 1] != '}') {
-        free(aligned);
-        return NULL;
+    if (len == 0) {
+        return 0;
     }
 
-    char* isolated = json_isolate_content(aligned);
-    size_t setting_count = json_count_isolated_settings(isolated);
-
-    if (setting_count < 1 && len > 2) {
-        free(aligned);
-        free(isolated);
-        return NULL;
+    for (size_t i = 0; simple[i] != '\0'; i += 2) {
+        if (str[0] == simple[i]) {
+            dest[0] = simple[i + 1];
+            *written = 1;
+            return 1;
+        }
     }
 
-    char** setting_strings = malloc(sizeof(char*) * (setting_count + 1));
-    setting_strings[setting_count] = NULL;
+    if (str[0] != 'u') {
+        return 0;
+    }
 
-    int quotes = 0;
-    int braces = 0;
-    size_t prev_pos = 0;
-    int str_index = 0;
-    for (size_t i = 0; isolated[i] != '\0'; i++) {
-        if (isolated[i] == '\"' && (i == 0 ? 1 : isolated[i - 1] != '\\')) { quotes++; }
-        if (isolated[i] == '{' && !(quotes % 2)) { braces++; }
-        if (isolated[i] == '}' && !(quotes % 2)) { braces--; }
-        if ((isolated[i] == ',' && !(quotes % 2) && !braces) || i == len - 3) {
-            int offset = i == len - 3 ? 2 : 1;
+    long cp = json_hex4(str + 1, len - 1);
+    size_t consumed = 5;
 
-            setting_strings[str_index] = malloc(i - prev_pos + offset);
-            setting_strings[str_index][i - prev_pos + offset - 1] = '\0';
-            strncpy(setting_strings[str_index], &isolated[prev_pos], i == len - 3 ? i + 1 - prev_pos : i - prev_pos);
+    if (cp >= 0xd800 && cp <= 0xdbff) {
+        long low = len >= 7 && str[5] == '\\' && str[6] == 'u' ? json_hex4(str + 7, len - 7) : -1;
 
-            str_index++;
-            prev_pos = i + 1;
+        if (low < 0xdc00 || low > 0xdfff) {
+            return 0;
         }
+        cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+        consumed = 11;
+    } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+        return 0;
     }
 
-    free(aligned);
-    free(isolated);
-    return setting_strings;
+    /* NUL can't be stored in a C string */
+    if (cp <= 0) {
+        return 0;
+    }
+
+    *written = json_utf8_encode(dest, cp);
+    return consumed;
 }
 
 /**
- * Converts a serialized JSON string to an object.
- * @param obj pointer to JSON object
- * @param str JSON string
- * @return -1 if unsuccessful, 0 if successful
+ * Decodes the escape sequences of a string value or key name, and validates it as UTF-8. Runs of bytes
+ * without escapes are found by json_scan_unescape and copied at once.
+ * @param doc Document the decoded string belongs to
+ * @param str Raw string, without its quotes
+ * @param len Length of the raw string
+ * @return NUL-terminated decoded string (never longer than the raw one), or NULL if the string is invalid
  */
-json_obj_t* json_from_string(const char* str) {
-    char** settings = json_get_string_settings(str);
+char* json_unescape(json_doc_t* doc, const char* str, size_t len) {
+    char* dest = json_malloc(doc, len + 1);
+    size_t j = 0;
 
-    if (settings == NULL) {
-        return NULL;
-    }
+    for (size_t i = 0; i < len;) {
+        size_t run = json_scan_unescape(str + i, len - i);
+        size_t consumed = 0;
+        size_t written = 0;
 
-    json_obj_t* obj = malloc(sizeof(json_obj_t));
+        memcpy(dest + j, str + i, run);
+        i += run;
+        j += run;
 
-    obj->settings = NULL;
-    obj->settings_count = (size_t)0;
+        if (i == len) {
+            break;
+        }
 
-    for (int i = 0; settings[i] != NULL; i++) {
-        obj->settings_count++;
-    }
+        if ((unsigned char)str[i] >= 0x80) {
+            consumed = json_utf8_sequence((const unsigned char*)str + i, len - i);
+            memcpy(dest + j, str + i, consumed);
+            written = consumed;
+        } else if (str[i] == '\\') {
+            consumed = json_unescape_sequence(str + i + 1, len - i - 1, dest + j, &written);
+            consumed += consumed != 0;
+        }
 
-    if (obj->settings_count) {
-        obj->settings = calloc(sizeof(json_setting_t) * obj->settings_count, sizeof(json_setting_t*));
+        /* Invalid UTF-8, invalid escape, or unescaped control character */
+        if (consumed == 0) {
+            json_dealloc(doc, dest);
+            return NULL;
+        }
 
-        for (size_t i = 0; i < obj->settings_count; i++) {
-            json_setting_t* setting = parse_setting_line(settings[i]);
+        i += consumed;
+        j += written;
+    }
 
-            if (setting == NULL) {
-                for (size_t j = 0; j < obj->settings_count; j++) {
-                    json_free_setting(obj->settings[j]);
-                }
-                free(obj->settings);
-                free(obj);
+    dest[j] = '\0';
+    return dest;
+}
 
-                json_free_double_char_array(settings);
-                return NULL;
-            }
-            obj->settings[i] = setting;
+/**
+ * Counts number of invisible characters in string
+ * @param str String pointer
+ * @return Number of invisible characters in string
+ */
+size_t json_count_invisible_characters(const char* str) {
+    int spaces = 0;
+    int quotes = 0;
+    for (int i = 0; str[i] != '\0'; i++) {
+        if (json_is_quote(str, i)) {
+            quotes++;
+        }
+        if (json_is_invisible(str[i]) && !(quotes % 2)) {
+            spaces++;
         }
     }
 
-    json_free_double_char_array(settings);
-    return obj;
+    return spaces;
 }
 
 /**
- * Gets content of file into string
- * @param fd valid file descriptor
- * @return string containing file content
+ * Get contents of an object between first and last braces
+ * @param str Serialized JSON object
+ * @return Content of object (without containing braces)
  */
-char* json_get_file_content(int fd) {
-    off_t raw_len = lseek(fd, 0, SEEK_END);
-    char *raw_ptr = mmap(0, raw_len, PROT_READ, MAP_PRIVATE, fd, 0);
-    char *file_content = malloc(raw_len + 1);
-    file_content[raw_len] = '\0';
-    strncpy(file_content, raw_ptr, raw_len);
-    munmap(raw_ptr, raw_len);
+char* json_isolate_content(const char *str) {
+    size_t len = strlen(str);
+    char* dest = json_malloc(NULL, len - 1);
 
-    return file_content;
+    dest[len - 2] = '\0';
+    strncpy(dest, str + 1, len - 2);
+
+    return dest;
 }
 
 /**
- * Frees a JSON object.
- * @param obj object to free
+ * Gets number of settings in isolated JSON object
+ * @param str Isolated json object
+ * @return Number of settings in string
  */
-void json_free(json_obj_t* obj) {
-    for (size_t i = 0; i < obj->settings_count; i++) {
-        json_free_setting(obj->settings[i]);
+size_t json_count_isolated_settings(const char *str) {
+    size_t count = 1;
+
+    int quotes = 0;
+    int braces = 0;
+    for (int i = 0; str[i] != '\0'; i++) {
+        if (json_is_quote(str, i)) { quotes++; }
+        if (str[i] == '{' && !(quotes % 2)) { braces++; }
+        if (str[i] == '}' && !(quotes % 2)) { braces--; }
+        if (str[i] == ',' && !(quotes % 2) && !braces && str[i+1] == '"') {
+            count++;
+        }
     }
 
-    free(obj->settings);
-    free(obj);
+    return count;
 }
 
 /**
- * Creates a new configuration object, creates necessary file if it doesn't exist.
- * @param obj pointer to config object holder
- * @param path path to the config file.
- * @return -1 on error, 0 on success
+ * Hashes a string of known length (FNV-1a)
+ * @param str String to hash
+ * @param len Length of the string in bytes
+ * @return 64 bits hash of the string
  */
-json_obj_t* json_from_file(const char *path) {
-    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0600);
+unsigned long long json_hash_bytes(const char* str, size_t len) {
+    unsigned long long hash = 0xcbf29ce484222325ULL;
 
-    if (fd == -1) {
-        return NULL;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 0x100000001b3ULL;
     }
 
-    if (json_get_file_size(fd) == 0) {
-        write(fd, "{}", 2);
+    return hash;
+}
+
+/**
+ * Mixes the bits of a 64 bits value (splitmix64 finalizer)
+ * @param x Value to mix
+ * @return Mixed value
+ */
+unsigned long long json_hash_mix(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+
+    return x;
+}
+
+/**
+ * Chunk of the key names arena of a document
+ */
+typedef struct json_chunk_s {
+    struct json_chunk_s* prev;
+    size_t used;
+    size_t size;
+    char data[];
+} json_chunk_t;
+
+/**
+ * Interned key name
+ */
+typedef struct json_intern_s {
+    char* str;
+    size_t len;
+    unsigned long long hash;
+} json_intern_t;
+
+/**
+ * State shared by every object of a document. Key names are interned in it, so each distinct key is
+ * stored once per document and settings of the document can be compared by name pointer.
+ * Cached hashes are valid for one generation of the document. Modifications invalidate the hashes of the
+ * objects on their key path only, the generation is incremented when that isn't enough (see json_modify_path).
+ */
+struct json_doc_s {
+    size_t refcount;
+    unsigned long long generation;
+    json_intern_t* interns;
+    size_t intern_count;
+    size_t intern_capacity;
+    json_chunk_t* chunk;
+    json_doc_t* owner;
+    json_allocator_t allocator;
+    json_stats_t stats;
+};
+
+/**
+ * Allocates memory with malloc, default allocator function
+ * @param size Size in bytes
+ * @param ctx Unused
+ * @return Allocated memory
+ */
+void* json_default_malloc(size_t size, void* ctx) {
+    (void)ctx;
+    return malloc(size);
+}
+
+/**
+ * Resizes memory with realloc, default allocator function
+ * @param ptr Memory to resize
+ * @param size New size in bytes
+ * @param ctx Unused
+ * @return Resized memory
+ */
+void* json_default_realloc(void* ptr, size_t size, void* ctx) {
+    (void)ctx;
+    return realloc(ptr, size);
+}
+
+/**
+ * Frees memory with free, default allocator function
+ * @param ptr Memory to free
+ * @param ctx Unused
+ */
+void json_default_free(void* ptr, void* ctx) {
+    (void)ctx;
+    free(ptr);
+}
+
+/**
+ * Allocator of the memory that doesn't belong to a document, and of new documents (see json_set_allocator)
+ */
+json_allocator_t json_global_allocator = { json_default_malloc, json_default_realloc, json_default_free, NULL };
+
+/**
+ * Statistics of the allocations and operations that don't belong to a document, and of all documents
+ */
+json_stats_t json_global_stats;
+
+/**
+ * Trace callback, see json_set_trace
+ */
+void (*json_trace_fn)(const json_trace_t* event, void* ctx);
+void* json_trace_ctx;
+
+#ifdef JSON_STATS
+#define JSON_STATS_ENABLED 1
+#define JSON_ALLOC_HEADER 16
+#define JSON_STAT(doc, field, value) json_stat_add((doc), offsetof(json_stats_t, field), (value))
+#else
+#define JSON_STATS_ENABLED 0
+#define JSON_ALLOC_HEADER 0
+#define JSON_STAT(doc, field, value) ((void)0)
+#endif
+
+/**
+ * Adds to a statistics counter of a document (and of its owner) and to the global one
+ * @param doc Document concerned, NULL if none
+ * @param offset Offset of the counter in json_stats_t
+ * @param value Value to add
+ */
+void json_stat_add(json_doc_t* doc, size_t offset, unsigned long long value) {
+    __atomic_add_fetch((unsigned long long*)((char*)&json_global_stats + offset), value, __ATOMIC_RELAXED);
+
+    if (doc != NULL) {
+        __atomic_add_fetch((unsigned long long*)((char*)&doc->owner->stats + offset), value, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Gets a monotonic timestamp
+ * @return Timestamp in nanoseconds
+ */
+unsigned long long json_now_ns(void) {
+#ifdef JSON_STATS
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Sends an event to the trace callback, if any
+ * @param type Type of the event
+ * @param bytes Number of bytes parsed or dumped
+ * @param ns Duration of the operation in nanoseconds
+ * @param key Key path of a missed lookup
+ */
+void json_trace(enum json_trace_type_e type, size_t bytes, unsigned long long ns, const char* key) {
+#ifdef JSON_STATS
+    void (*trace)(const json_trace_t*, void*) = __atomic_load_n(&json_trace_fn, __ATOMIC_ACQUIRE);
+
+    if (trace != NULL) {
+        json_trace_t event = { type, bytes, ns, key };
+        trace(&event, json_trace_ctx);
+    }
+#else
+    (void)type;
+    (void)bytes;
+    (void)ns;
+    (void)key;
+#endif
+}
+
+/**
+ * Records a parse or a dump in the statistics and sends it to the trace callback
+ * @param doc Document parsed or dumped
+ * @param type TraceParse or TraceDump
+ * @param bytes Size of the JSON text
+ * @param start Timestamp of the start of the operation (json_now_ns)
+ */
+void json_record(json_doc_t* doc, enum json_trace_type_e type, size_t bytes, unsigned long long start) {
+#ifdef JSON_STATS
+    unsigned long long ns = json_now_ns() - start;
+
+    if (type == TraceParse) {
+        JSON_STAT(doc, parse_count, 1);
+        JSON_STAT(doc, parse_bytes, bytes);
+        JSON_STAT(doc, parse_ns, ns);
+    } else {
+        JSON_STAT(doc, dump_count, 1);
+        JSON_STAT(doc, dump_bytes, bytes);
+        JSON_STAT(doc, dump_ns, ns);
+    }
+
+    json_trace(type, bytes, ns, NULL);
+#else
+    (void)doc;
+    (void)type;
+    (void)bytes;
+    (void)start;
+#endif
+}
+
+/**
+ * Allocates memory on behalf of a document. When statistics are compiled in, the size of the allocation is
+ * kept in a header in front of it.
+ * @param doc Document the memory belongs to, NULL for temporary memory of the library
+ * @param size Size in bytes
+ * @return Allocated memory, to free with json_dealloc
+ */
+void* json_malloc(json_doc_t* doc, size_t size) {
+    const json_allocator_t* allocator = doc != NULL ? &doc->allocator : &json_global_allocator;
+    char* ptr = allocator->malloc(size + JSON_ALLOC_HEADER, allocator->ctx);
+
+    if (ptr == NULL) {
+        return NULL;
+    }
+
+#ifdef JSON_STATS
+    *(size_t*)ptr = size;
+    JSON_STAT(doc, allocations, 1);
+    JSON_STAT(doc, allocated_bytes, size);
+    JSON_STAT(doc, live_bytes, size);
+#else
+    (void)doc;
+#endif
+    return ptr + JSON_ALLOC_HEADER;
+}
+
+/**
+ * Allocates zeroed memory on behalf of a document
+ * @param doc Document the memory belongs to, NULL for temporary memory of the library
+ * @param count Number of elements
+ * @param size Size of an element in bytes
+ * @return Allocated memory, to free with json_dealloc
+ */
+void* json_calloc(json_doc_t* doc, size_t count, size_t size) {
+    void* ptr = json_malloc(doc, count * size);
+
+    if (ptr != NULL) {
+        memset(ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+/**
+ * Resizes memory allocated with json_malloc
+ * @param doc Document the memory belongs to, NULL for temporary memory of the library
+ * @param ptr Memory to resize, can be NULL
+ * @param size New size in bytes
+ * @return Resized memory, or NULL on failure (ptr is left untouched)
+ */
+void* json_realloc(json_doc_t* doc, void* ptr, size_t size) {
+    if (ptr == NULL) {
+        return json_malloc(doc, size);
+    }
+
+    const json_allocator_t* allocator = doc != NULL ? &doc->allocator : &json_global_allocator;
+    char* base = allocator->realloc((char*)ptr - JSON_ALLOC_HEADER, size + JSON_ALLOC_HEADER, allocator->ctx);
+
+    if (base == NULL) {
+        return NULL;
+    }
+
+#ifdef JSON_STATS
+    size_t old = *(size_t*)base;
+    *(size_t*)base = size;
+    JSON_STAT(doc, allocations, 1);
+    JSON_STAT(doc, allocated_bytes, size);
+    JSON_STAT(doc, live_bytes, size - old);
+    JSON_STAT(doc, frees, 1);
+#endif
+    return base + JSON_ALLOC_HEADER;
+}
+
+/**
+ * Frees memory allocated with json_malloc
+ * @param doc Document the memory belongs to, NULL for temporary memory of the library
+ * @param ptr Memory to free, can be NULL
+ */
+void json_dealloc(json_doc_t* doc, void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+
+    const json_allocator_t* allocator = doc != NULL ? &doc->allocator : &json_global_allocator;
+    char* base = (char*)ptr - JSON_ALLOC_HEADER;
+
+#ifdef JSON_STATS
+    JSON_STAT(doc, live_bytes, -*(size_t*)base);
+    JSON_STAT(doc, frees, 1);
+#endif
+    allocator->free(base, allocator->ctx);
+}
+
+/**
+ * Takes a reference on a document
+ * @param doc Document to reference
+ * @return The document
+ */
+json_doc_t* json_doc_retain(json_doc_t* doc) {
+    __atomic_add_fetch(&doc->refcount, 1, __ATOMIC_RELAXED);
+    return doc;
+}
+
+/**
+ * Creates an empty document
+ * @param parent Document whose statistics and allocator are shared by the new one, NULL for an independent document
+ * @param allocator Allocator of an independent document, NULL to use the global allocator
+ * @return The document, with a reference count of 1, or NULL if the allocator fails
+ */
+json_doc_t* json_doc_new(json_doc_t* parent, const json_allocator_t* allocator) {
+    if (parent != NULL) {
+        allocator = &parent->allocator;
+    } else if (allocator == NULL) {
+        allocator = &json_global_allocator;
+    }
+
+    json_doc_t* doc = allocator->malloc(sizeof(json_doc_t), allocator->ctx);
+
+    if (doc == NULL) {
+        return NULL;
+    }
+
+    memset(doc, 0, sizeof(json_doc_t));
+    doc->allocator = *allocator;
+    doc->refcount = 1;
+    doc->generation = 1;
+    doc->owner = parent != NULL ? parent->owner : doc;
+    doc->intern_count = 0;
+    doc->intern_capacity = 64;
+    doc->interns = json_calloc(doc, doc->intern_capacity, sizeof(json_intern_t));
+    doc->chunk = NULL;
+
+    if (doc->interns == NULL) {
+        allocator->free(doc, allocator->ctx);
+        return NULL;
+    }
+    if (parent != NULL) {
+        json_doc_retain(parent->owner);
+    }
+
+    return doc;
+}
+
+/**
+ * Drops a reference on a document, frees it with its key names when it was the last one
+ * @param doc Document to release
+ */
+void json_doc_release(json_doc_t* doc) {
+    if (__atomic_sub_fetch(&doc->refcount, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    while (doc->chunk != NULL) {
+        json_chunk_t* prev = doc->chunk->prev;
+        json_dealloc(doc, doc->chunk);
+        doc->chunk = prev;
+    }
+
+    json_dealloc(doc, doc->interns);
+
+    if (doc->owner != doc) {
+        json_doc_release(doc->owner);
+    }
+    doc->allocator.free(doc, doc->allocator.ctx);
+}
+
+/**
+ * Finds an interned key name in a document
+ * @param doc Document to search
+ * @param str Key name, not necessarily NUL-terminated
+ * @param len Length of the key name
+ * @param hash Hash of the key name (json_hash_bytes)
+ * @return The interned key name, or NULL if no setting of the document has this name
+ */
+char* json_intern_find(json_doc_t* doc, const char* str, size_t len, unsigned long long hash) {
+    size_t mask = doc->intern_capacity - 1;
+
+    for (size_t i = hash & mask; doc->interns[i].str != NULL; i = (i + 1) & mask) {
+        json_intern_t* entry = &doc->interns[i];
+
+        if (entry->hash == hash && entry->len == len && memcmp(entry->str, str, len) == 0) {
+            return entry->str;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Interns a key name in a document, stores it if it's the first occurrence
+ * @param doc Document in which intern the key name
+ * @param str Key name, not necessarily NUL-terminated
+ * @param len Length of the key name
+ * @return The interned NUL-terminated key name, owned by the document
+ */
+char* json_intern(json_doc_t* doc, const char* str, size_t len) {
+    unsigned long long hash = json_hash_bytes(str, len);
+    char* interned = json_intern_find(doc, str, len, hash);
+
+    if (interned != NULL) {
+        return interned;
+    }
+
+    if ((doc->intern_count + 1) * 2 > doc->intern_capacity) {
+        size_t capacity = doc->intern_capacity * 2;
+        json_intern_t* interns = json_calloc(doc, capacity, sizeof(json_intern_t));
+
+        for (size_t i = 0; i < doc->intern_capacity; i++) {
+            if (doc->interns[i].str == NULL) {
+                continue;
+            }
+
+            size_t j = doc->interns[i].hash & (capacity - 1);
+            while (interns[j].str != NULL) {
+                j = (j + 1) & (capacity - 1);
+            }
+            interns[j] = doc->interns[i];
+        }
+
+        json_dealloc(doc, doc->interns);
+        doc->interns = interns;
+        doc->intern_capacity = capacity;
+    }
+
+    if (doc->chunk == NULL || doc->chunk->size - doc->chunk->used < len + 1) {
+        size_t size = len + 1 > 4096 ? len + 1 : 4096;
+        json_chunk_t* chunk = json_malloc(doc, sizeof(json_chunk_t) + size);
+
+        chunk->prev = doc->chunk;
+        chunk->used = 0;
+        chunk->size = size;
+        doc->chunk = chunk;
+    }
+
+    interned = &doc->chunk->data[doc->chunk->used];
+    doc->chunk->used += len + 1;
+    memcpy(interned, str, len);
+    interned[len] = '\0';
+
+    size_t i = hash & (doc->intern_capacity - 1);
+    while (doc->interns[i].str != NULL) {
+        i = (i + 1) & (doc->intern_capacity - 1);
+    }
+    doc->interns[i].str = interned;
+    doc->interns[i].len = len;
+    doc->interns[i].hash = hash;
+    doc->intern_count++;
+
+    return interned;
+}
+
+/**
+ * Creates an empty object belonging to a document
+ * @param doc Document of the object
+ * @return The created object
+ */
+json_obj_t* json_new_object(json_doc_t* doc) {
+    json_obj_t* obj = json_malloc(doc, sizeof(json_obj_t));
+
+    obj->settings = NULL;
+    obj->settings_count = (size_t)0;
+    obj->frozen = NULL;
+    obj->doc = json_doc_retain(doc);
+    obj->hash = 0;
+    obj->hash_generation = 0;
+    obj->hash128[0] = 0;
+    obj->hash128[1] = 0;
+    obj->hash128_generation = 0;
+    obj->hash_observed = 0;
+    obj->refcount = 1;
+
+    return obj;
+}
+
+/**
+ * Hashes a string of known length into 128 bits, with two lanes mixed independently 8 bytes at a time
+ * @param str String to hash
+ * @param len Length of the string in bytes
+ * @param hash Receives the 128 bits hash of the string
+ */
+void json_hash_bytes128(const char* str, size_t len, unsigned long long hash[2]) {
+    unsigned long long a = 0x9e3779b97f4a7c15ULL ^ len;
+    unsigned long long b = 0xc2b2ae3d27d4eb4fULL + len;
+
+    for (size_t i = 0; i < len; i += 8) {
+        unsigned long long word = 0;
+
+        memcpy(&word, str + i, len - i < 8 ? len - i : 8);
+        a = json_hash_mix(a ^ word);
+        b = json_hash_mix((b + ((word << 32) | (word >> 32))) * 0x9fb21c651e98df25ULL);
+    }
+
+    hash[0] = a;
+    hash[1] = b;
+}
+
+/**
+ * Gets the bytes of a floating point number, equal values have equal bytes whatever their representation
+ * @param value Number
+ * @param bytes Receives the bytes of the number
+ */
+void json_floating_bytes(long double value, unsigned char bytes[sizeof(long double)]) {
+    if (value == 0) {
+        value = 0;
+    } else if (isnan(value)) {
+        value = NAN;
+    }
+
+    memset(bytes, 0, sizeof(long double));
+    memcpy(bytes, &value, LDBL_MANT_DIG == 64 ? 10 : sizeof(long double));
+}
+
+/**
+ * Hashes a floating point number, equal values have equal hashes whatever their representation
+ * @param value Number to hash
+ * @return 64 bits hash of the number
+ */
+unsigned long long json_hash_floating(long double value) {
+    unsigned char bytes[sizeof(long double)];
+
+    json_floating_bytes(value, bytes);
+    return json_hash_bytes((const char*)bytes, sizeof(bytes));
+}
+
+/**
+ * Checks whether the cached hash of an object can stay valid until its key path is modified. A sub-object
+ * of another document (see json_set_object) can be modified through its own document only, so the hash of
+ * its parent is recomputed on every call (the sub-object's own hash stays cached).
+ * @param parent Parent object
+ * @param child Sub-object, already hashed
+ * @param generation Generation at which the hash of the child was cached
+ * @return Boolean value
+ */
+int json_hash_cacheable(json_obj_t* parent, json_obj_t* child, unsigned long long generation) {
+    return child->frozen != NULL || (child->doc == parent->doc && generation != 0);
+}
+
+unsigned long long json_obj_hash(json_obj_t* obj);
+
+/**
+ * Hashes the value of a setting, the type of the value is part of the hash
+ * @param setting Setting to hash
+ * @return 64 bits hash of the value
+ */
+unsigned long long json_value_hash(json_setting_t* setting) {
+    switch (setting->type) {
+        case Boolean: return json_hash_mix(0x1000 + (setting->bool_type != 0));
+        case Integer: return json_hash_mix(0x2000 ^ json_hash_mix((unsigned long long)setting->long_type));
+        case Floating: return json_hash_mix(0x3000 ^ json_hash_floating(setting->double_type));
+        case String: return json_hash_mix(0x4000 ^ json_hash_bytes(setting->string_type, strlen(setting->string_type)));
+        case Object: return setting->obj_type == NULL ? json_hash_mix(0x5000) : json_obj_hash(setting->obj_type);
+    }
+
+    return 0;
+}
+
+/**
+ * Gets the structural hash of an object. Members are combined with a commutative sum so the hash doesn't
+ * depend on key order. The hash is cached in the object until the object or one of its sub-objects is
+ * modified; frozen objects can't be modified and keep it forever.
+ * @param obj Object to hash
+ * @return 64 bits hash of the object
+ */
+unsigned long long json_obj_hash(json_obj_t* obj) {
+    if (obj->frozen != NULL || obj->hash_generation == obj->doc->generation) {
+        return obj->hash;
+    }
+
+    unsigned long long sum = 0;
+    int cacheable = 1;
+
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        json_setting_t* setting = obj->settings[i];
+        unsigned long long name = json_hash_bytes(setting->name, strlen(setting->name));
+
+        sum += json_hash_mix(name + json_hash_mix(json_value_hash(setting)));
+
+        if (setting->type == Object && setting->obj_type != NULL) {
+            cacheable &= json_hash_cacheable(obj, setting->obj_type, setting->obj_type->hash_generation);
+            setting->obj_type->hash_observed = 1;
+        }
+    }
+
+    obj->hash = json_hash_mix(0x6000 ^ json_hash_mix(sum + obj->settings_count));
+    obj->hash_generation = cacheable ? obj->doc->generation : 0;
+
+    return obj->hash;
+}
+
+void json_obj_hash128(json_obj_t* obj, unsigned long long hash[2]);
+
+/**
+ * Hashes the value of a setting into 128 bits, the type of the value is part of the hash
+ * @param setting Setting to hash
+ * @param hash Receives the 128 bits hash of the value
+ */
+void json_value_hash128(json_setting_t* setting, unsigned long long hash[2]) {
+    unsigned char bytes[sizeof(long double)];
+    unsigned long long tag = 0x1000 * (setting->type + 1);
+
+    switch (setting->type) {
+        case Boolean:
+            hash[0] = setting->bool_type != 0;
+            hash[1] = setting->bool_type != 0;
+            break;
+        case Integer:
+            hash[0] = json_hash_mix((unsigned long long)setting->long_type);
+            hash[1] = json_hash_mix((unsigned long long)setting->long_type * 0x9fb21c651e98df25ULL);
+            break;
+        case Floating:
+            json_floating_bytes(setting->double_type, bytes);
+            json_hash_bytes128((const char*)bytes, sizeof(bytes), hash);
+            break;
+        case String:
+            json_hash_bytes128(setting->string_type, strlen(setting->string_type), hash);
+            break;
+        case Object:
+            if (setting->obj_type != NULL) {
+                json_obj_hash128(setting->obj_type, hash);
+                return;
+            }
+            hash[0] = 0;
+            hash[1] = 0;
+            break;
+    }
+
+    hash[0] = json_hash_mix(tag ^ hash[0]);
+    hash[1] = json_hash_mix((tag + hash[1]) * 0xd6e8feb86659fd93ULL);
+}
+
+/**
+ * Gets the 128 bits structural hash of an object, computed like json_obj_hash with a second independent
+ * lane. It is cached separately once requested; frozen objects get it when frozen, so that it is only read
+ * afterwards.
+ * @param obj Object to hash
+ * @param hash Receives the 128 bits hash of the object
+ */
+void json_obj_hash128(json_obj_t* obj, unsigned long long hash[2]) {
+    int valid = obj->frozen != NULL ? obj->hash128_generation != 0 : obj->hash128_generation == obj->doc->generation;
+
+    if (!valid) {
+        unsigned long long sum[2] = { 0, 0 };
+        int cacheable = 1;
+
+        for (size_t i = 0; i < obj->settings_count; i++) {
+            json_setting_t* setting = obj->settings[i];
+            unsigned long long name[2];
+            unsigned long long value[2];
+
+            json_hash_bytes128(setting->name, strlen(setting->name), name);
+            json_value_hash128(setting, value);
+            sum[0] += json_hash_mix(name[0] + json_hash_mix(value[0]));
+            sum[1] += json_hash_mix((name[1] ^ json_hash_mix(value[1] + 0x5bd1e995ULL)) * 0x9fb21c651e98df25ULL);
+
+            if (setting->type == Object && setting->obj_type != NULL) {
+                cacheable &= json_hash_cacheable(obj, setting->obj_type, setting->obj_type->hash128_generation);
+                setting->obj_type->hash_observed = 1;
+            }
+        }
+
+        obj->hash128[0] = json_hash_mix(0x6000 ^ json_hash_mix(sum[0] + obj->settings_count));
+        obj->hash128[1] = json_hash_mix(0x7000 + json_hash_mix(sum[1] ^ obj->settings_count));
+        obj->hash128_generation = cacheable || obj->frozen != NULL ? obj->doc->generation : 0;
+    }
+
+    hash[0] = obj->hash128[0];
+    hash[1] = obj->hash128[1];
+}
+
+/**
+ * Gets the content hash of an object: it only depends on the settings, their types and values, not on the
+ * order of the keys nor on the formatting of the text the object was parsed from. The hash is computed
+ * without serializing the object on the first call and is cached until the object is modified, so calling
+ * it again on an unchanged object is cheap. It is not a cryptographic hash.
+ * @param obj Object to hash
+ * @return 64 bits hash of the object, 0 if obj is NULL
+ */
+unsigned long long json_hash(json_obj_t* obj) {
+    return obj != NULL ? json_obj_hash(obj) : 0;
+}
+
+/**
+ * Gets the 128 bits content hash of an object (see json_hash), for keys that must practically never collide
+ * @param obj Object to hash
+ * @param hash Receives the 128 bits hash of the object, zeros if obj is NULL
+ */
+void json_hash128(json_obj_t* obj, unsigned long long hash[2]) {
+    if (obj == NULL) {
+        hash[0] = 0;
+        hash[1] = 0;
+        return;
+    }
+
+    json_obj_hash128(obj, hash);
+}
+
+/**
+ * Frees a single setting from memory
+ * @param doc Document of the object holding the setting
+ * @param setting Setting object to free
+ */
+void json_free_setting(json_doc_t* doc, json_setting_t *setting) {
+    if (setting == NULL) {
+        return;
+    }
+
+    if (setting->type == String) {
+        json_dealloc(doc, setting->string_type);
+    } else if (setting->type == Object && setting->obj_type != NULL) {
+        json_free(setting->obj_type);
+    }
+
+    json_dealloc(doc, setting);
+}
+
+json_obj_t* json_parse_object(const char* str, json_doc_t* doc);
+
+/**
+ * Interns a raw key name, decoding its escape sequences
+ * @param doc Document in which intern the key name
+ * @param str Raw key name, without its quotes
+ * @param len Length of the raw key name
+ * @return The interned key name, or NULL if it is invalid
+ */
+char* json_intern_key(json_doc_t* doc, const char* str, size_t len) {
+    if (json_scan_unescape(str, len) == len) {
+        return json_intern(doc, str, len);
+    }
+
+    char* key = json_unescape(doc, str, len);
+
+    if (key == NULL) {
+        return NULL;
+    }
+
+    char* name = json_intern(doc, key, strlen(key));
+    json_dealloc(doc, key);
+    return name;
+}
+
+/**
+ * Records the size of the buffer of a string setting, so that updates can reuse it without measuring the
+ * current string. Buffers too big to be recorded are never reused.
+ * @param setting String setting
+ * @param size Size of its buffer in bytes, NUL character included
+ */
+void json_set_string_cap(json_setting_t* setting, size_t size) {
+    setting->string_cap = size <= UINT_MAX ? (unsigned int)size : 0;
+}
+
+/**
+ * Deserializes unique json setting
+ * @param string Serialized setting of type "key":"value"
+ * @param doc Document in which intern the key name
+ * @return -1 on error, 0 on success
+ */
+json_setting_t* parse_setting_line(const char *string, json_doc_t* doc) {
+    json_setting_t* set = json_malloc(doc, sizeof(json_setting_t));
+    size_t len = strlen(string);
+    char* str_value = NULL;
+
+    set->name = NULL;
+
+    int found = 0;
+    int quotes = 0;
+    size_t colon = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (json_is_quote(string, i)) { quotes++; }
+        if (string[i] == ',' && i == len - 1) {
+            json_dealloc(doc, set);
+            return NULL;
+        }
+        if (string[i] == ':' && !(quotes % 2) && !found && string[i - 1] == '\"') {
+            found = 1;
+            colon = i;
+            set->name = json_intern_key(doc, &string[1], i - 2);
+        }
+        if (i == len - 1) {
+            str_value = json_malloc(doc, i - colon + 1);
+            str_value[i - colon] = '\0';
+            strncpy(str_value, &string[colon + 1], i - colon);
+            break;
+        }
+    }
+
+    if (set->name == NULL || str_value == NULL) {
+        json_dealloc(doc, set);
+        json_dealloc(doc, str_value);
+        return NULL;
+    }
+
+    if (str_value[0] == '\"') {
+        size_t len2 = strlen(str_value);
+        set->type = String;
+        set->string_type = len2 >= 2 ? json_unescape(doc, &str_value[1], len2 - 2) : NULL;
+        json_set_string_cap(set, len2 - 1);
+
+        if (set->string_type == NULL) {
+            json_dealloc(doc, set);
+            json_dealloc(doc, str_value);
+            return NULL;
+        }
+    } else if (str_value[0] == 't' || str_value[0] == 'f') {
+        set->type = Boolean;
+        set->bool_type = strcmp(str_value, "true") == 0 ? 1 : 0;
+    } else if (str_value[0] == '-' || (str_value[0] >= '0' && str_value[0] <= '9')) {
+        if (strchr(str_value, '.')) {
+            set->type = Floating;
+            set->double_type = strtod(str_value, NULL);
+        } else {
+            set->type = Integer;
+            set->long_type = strtoll(str_value, NULL, 10);
+        }
+    } else if (str_value[0] == '{') {
+        set->type = Object;
+        set->obj_type = json_parse_object(str_value, doc);
+    } else if (str_value[0] == 'n') {
+        set->type = Object;
+        set->obj_type = NULL;
+    } else {
+        json_dealloc(doc, set);
+        json_dealloc(doc, str_value);
+        return NULL;
+    }
+
+    json_dealloc(doc, str_value);
+    return set;
+}
+
+/**
+ * Clears invisible characters in string for further processing
+ * @param str Pointer to string to clear
+ * @return Cleared string pointer
+ */
+char* json_align(const char* str) {
+    size_t len = strlen(str);
+    size_t spaces = json_count_invisible_characters(str);
+    char *aligned = json_malloc(NULL, len - spaces + 1);
+    aligned[len - spaces] = '\0';
+
+    int j = 0;
+    int quotes = 0;
+    for (int i = 0; str[i] != '\0'; i++) {
+        if (json_is_quote(str, i)) { quotes++; }
+        if (json_is_invisible(str[i]) && !(quotes % 2)) { continue; }
+        aligned[j] = str[i];
+        j++;
+    }
+
+    return aligned;
+}
+
+/**
+ * Extracts strings from a serialized JSON object, each containing one setting of the object
+ * @param str Serialized JSON string
+ * @return Array of json setting names
+ */
+char** json_get_string_settings(const char *str) {
+    char* aligned = json_align(str);
+    size_t len = strlen(aligned);
+
+    if (len < 2 || aligned[0] != '{' || aligned[len - 1] != '}') {
+        json_dealloc(NULL, aligned);
+        return NULL;
+    }
+
+    char* isolated = json_isolate_content(aligned);
+    size_t setting_count = isolated[0] == '\0' ? 0 : json_count_isolated_settings(isolated);
+
+    if (setting_count < 1 && len > 2) {
+        json_dealloc(NULL, aligned);
+        json_dealloc(NULL, isolated);
+        return NULL;
+    }
+
+    char** setting_strings = json_malloc(NULL, sizeof(char*) * (setting_count + 1));
+    setting_strings[setting_count] = NULL;
+
+    int quotes = 0;
+    int braces = 0;
+    size_t prev_pos = 0;
+    int str_index = 0;
+    for (size_t i = 0; isolated[i] != '\0'; i++) {
+        if (json_is_quote(isolated, i)) { quotes++; }
+        if (isolated[i] == '{' && !(quotes % 2)) { braces++; }
+        if (isolated[i] == '}' && !(quotes % 2)) { braces--; }
+        if ((isolated[i] == ',' && !(quotes % 2) && !braces) || i == len - 3) {
+            int offset = i == len - 3 ? 2 : 1;
+
+            setting_strings[str_index] = json_malloc(NULL, i - prev_pos + offset);
+            setting_strings[str_index][i - prev_pos + offset - 1] = '\0';
+            strncpy(setting_strings[str_index], &isolated[prev_pos], i == len - 3 ? i + 1 - prev_pos : i - prev_pos);
+
+            str_index++;
+            prev_pos = i + 1;
+        }
+    }
+
+    json_dealloc(NULL, aligned);
+    json_dealloc(NULL, isolated);
+    return setting_strings;
+}
+
+/**
+ * Converts a serialized JSON object to an object belonging to a document.
+ * @param str JSON string
+ * @param doc Document of the created objects
+ * @return The object, or NULL if unsuccessful
+ */
+json_obj_t* json_parse_object(const char* str, json_doc_t* doc) {
+    char** settings = json_get_string_settings(str);
+
+    if (settings == NULL) {
+        return NULL;
+    }
+
+    json_obj_t* obj = json_new_object(doc);
+
+    for (int i = 0; settings[i] != NULL; i++) {
+        obj->settings_count++;
+    }
+
+    if (obj->settings_count) {
+        obj->settings = json_calloc(doc, obj->settings_count, sizeof(json_setting_t*));
+
+        for (size_t i = 0; i < obj->settings_count; i++) {
+            json_setting_t* setting = parse_setting_line(settings[i], doc);
+
+            if (setting == NULL) {
+                for (size_t j = 0; j < obj->settings_count; j++) {
+                    json_free_setting(doc, obj->settings[j]);
+                }
+                json_dealloc(doc, obj->settings);
+                json_dealloc(doc, obj);
+                json_doc_release(doc);
+
+                json_free_double_char_array(settings);
+                return NULL;
+            }
+            obj->settings[i] = setting;
+        }
+    }
+
+    json_free_double_char_array(settings);
+    return obj;
+}
+
+/**
+ * Converts a serialized JSON string to an object whose memory comes from an allocator. Objects set into it
+ * later keep the allocator of their own document.
+ * @param str JSON string
+ * @param allocator Allocator of the object's document, NULL to use the global allocator
+ * @return The object, or NULL if unsuccessful
+ */
+json_obj_t* json_from_string_allocator(const char* str, const json_allocator_t* allocator) {
+    unsigned long long start = json_now_ns();
+    json_doc_t* doc = json_doc_new(NULL, allocator);
+
+    if (doc == NULL) {
+        return NULL;
+    }
+
+    json_obj_t* obj = json_parse_object(str, doc);
+
+    json_record(doc, TraceParse, JSON_STATS_ENABLED ? strlen(str) : 0, start);
+    json_doc_release(doc);
+    return obj;
+}
+
+/**
+ * Converts a serialized JSON string to an object.
+ * @param str JSON string
+ * @return The object, or NULL if unsuccessful
+ */
+json_obj_t* json_from_string(const char* str) {
+    return json_from_string_allocator(str, NULL);
+}
+
+/**
+ * Shared state of a json_parallel_for pool
+ */
+typedef struct json_parallel_s {
+    size_t next;
+    size_t count;
+    void (*fn)(size_t index, void* ctx, unsigned int worker);
+    void* ctx;
+} json_parallel_t;
+
+/**
+ * Thread of a json_parallel_for pool
+ */
+typedef struct json_parallel_worker_s {
+    json_parallel_t* pool;
+    unsigned int worker;
+} json_parallel_worker_t;
+
+/**
+ * Thread routine of json_parallel_for
+ * @param arg Worker (json_parallel_worker_t*)
+ * @return NULL
+ */
+void* json_parallel_routine(void* arg) {
+    json_parallel_worker_t* worker = arg;
+    json_parallel_t* pool = worker->pool;
+
+    for (;;) {
+        size_t index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+
+        if (index >= pool->count) {
+            return NULL;
+        }
+        pool->fn(index, pool->ctx, worker->worker);
+    }
+}
+
+/**
+ * Gets the number of threads to use for a parallel operation
+ * @param threads Requested number of threads, 0 to use one per online processor
+ * @return Number of threads, at least 1
+ */
+unsigned int json_parallel_threads(unsigned int threads) {
+    if (threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = online > 0 ? (unsigned int)online : 1;
+    }
+
+    return threads;
+}
+
+/**
+ * Runs fn(index, ctx, worker) for every index in [0, count) on a pool of threads. Indexes are handed out
+ * dynamically so that uneven tasks are balanced between the workers.
+ * @param count Number of tasks
+ * @param threads Number of threads (see json_parallel_threads)
+ * @param fn Task function, worker is the index of the thread running the task
+ * @param ctx Context passed to fn
+ */
+void json_parallel_for(size_t count, unsigned int threads, void (*fn)(size_t, void*, unsigned int), void* ctx) {
+    json_parallel_t pool = { 0, count, fn, ctx };
+    json_parallel_worker_t* workers = json_malloc(NULL, sizeof(json_parallel_worker_t) * threads);
+    pthread_t* ids = json_malloc(NULL, sizeof(pthread_t) * threads);
+    unsigned int started = 1;
+
+    for (unsigned int i = 0; i < threads; i++) {
+        workers[i].pool = &pool;
+        workers[i].worker = i;
+    }
+
+    /* The calling thread is worker 0, threads that fail to start are simply not used */
+    for (; started < threads && started < count; started++) {
+        if (pthread_create(&ids[started], NULL, json_parallel_routine, &workers[started]) != 0) {
+            break;
+        }
+    }
+
+    json_parallel_routine(&workers[0]);
+
+    for (unsigned int i = 1; i < started; i++) {
+        pthread_join(ids[i], NULL);
+    }
+
+    json_dealloc(NULL, workers);
+    json_dealloc(NULL, ids);
+}
+
+/**
+ * Finds the colon separating the key from the value in a serialized setting
+ * @param string Serialized setting of type "key":"value"
+ * @return Index of the colon, 0 if not found
+ */
+size_t json_find_colon(const char* string) {
+    int quotes = 0;
+
+    for (size_t i = 0; string[i] != '\0'; i++) {
+        if (json_is_quote(string, i)) { quotes++; }
+        if (string[i] == ':' && !(quotes % 2) && i > 0 && string[i - 1] == '\"') {
+            return i;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Setting to parse by a worker of json_from_string_parallel
+ */
+typedef struct json_parse_task_s {
+    const char* line;
+    json_setting_t** slot;
+} json_parse_task_t;
+
+/**
+ * Shared state of json_from_string_parallel
+ */
+typedef struct json_parse_job_s {
+    json_parse_task_t* tasks;
+    json_doc_t** docs;
+    int failed;
+} json_parse_job_t;
+
+/**
+ * Parses one setting of json_from_string_parallel into the document of the worker
+ * @param index Index of the task
+ * @param ctx Job (json_parse_job_t*)
+ * @param worker Index of the worker
+ */
+void json_parse_task(size_t index, void* ctx, unsigned int worker) {
+    json_parse_job_t* job = ctx;
+    json_parse_task_t* task = &job->tasks[index];
+
+    if (__atomic_load_n(&job->failed, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    *task->slot = parse_setting_line(task->line, job->docs[worker]);
+
+    if (*task->slot == NULL) {
+        __atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * Moves an object parsed by a worker of json_from_string_parallel, and its sub-objects, to the document
+ * of the result: key names are interned again in it and the objects hold it instead of the worker document.
+ * Worker documents share the allocator of the result, so the memory of the objects stays valid.
+ * @param obj Object to move
+ * @param doc Document of the result
+ */
+void json_rehome(json_obj_t* obj, json_doc_t* doc) {
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        json_setting_t* set = obj->settings[i];
+        set->name = json_intern(doc, set->name, strlen(set->name));
+
+        if (set->type == Object && set->obj_type != NULL) {
+            json_rehome(set->obj_type, doc);
+        }
+    }
+
+    if (obj->doc != doc) {
+        json_doc_release(obj->doc);
+        obj->doc = json_doc_retain(doc);
+    }
+}
+
+/**
+ * Converts a serialized JSON string to an object, parsing independent members on multiple threads.
+ * The top level members (and the members of top level objects when there are fewer top level members
+ * than threads) are located by a structural pre-scan, parsed concurrently, then stitched into one object.
+ * @param str JSON string
+ * @param threads Number of threads, 0 to use one per online processor
+ * @return The object, or NULL if unsuccessful
+ */
+json_obj_t* json_from_string_parallel(const char* str, unsigned int threads) {
+    unsigned long long start = json_now_ns();
+    char** settings = json_get_string_settings(str);
+
+    if (settings == NULL) {
+        return NULL;
+    }
+
+    threads = json_parallel_threads(threads);
+
+    json_doc_t* doc = json_doc_new(NULL, NULL);
+
+    if (doc == NULL) {
+        json_free_double_char_array(settings);
+        return NULL;
+    }
+
+    json_obj_t* obj = json_new_object(doc);
+    size_t count = json_key_count(settings);
+    size_t task_count = 0;
+    int expand = count < threads;
+    char*** children = json_calloc(doc, count + 1, sizeof(char**));
+
+    obj->settings_count = count;
+    obj->settings = json_calloc(doc, count + 1, sizeof(json_setting_t*));
+
+    /* Members that are objects are split again when the top level is too narrow to feed every thread */
+    for (size_t i = 0; i < count; i++) {
+        size_t colon = json_find_colon(settings[i]);
+
+        if (expand && colon != 0 && settings[i][colon + 1] == '{') {
+            children[i] = json_get_string_settings(&settings[i][colon + 1]);
+        }
+        task_count += children[i] != NULL ? json_key_count(children[i]) : 1;
+    }
+
+    json_parse_job_t job = {
+        json_malloc(doc, sizeof(json_parse_task_t) * (task_count + 1)), json_malloc(doc, sizeof(json_doc_t*) * threads), 0
+    };
+
+    for (size_t i = 0, t = 0; i < count; i++) {
+        if (children[i] == NULL) {
+            job.tasks[t++] = (json_parse_task_t){ settings[i], &obj->settings[i] };
+            continue;
+        }
+
+        size_t colon = json_find_colon(settings[i]);
+        json_setting_t* set = json_malloc(doc, sizeof(json_setting_t));
+        json_obj_t* child = json_new_object(doc);
+
+        child->settings_count = json_key_count(children[i]);
+        child->settings = json_calloc(doc, child->settings_count + 1, sizeof(json_setting_t*));
+        set->name = json_intern_key(doc, &settings[i][1], colon - 2);
+        set->type = Object;
+        set->obj_type = child;
+        obj->settings[i] = set;
+        job.failed |= set->name == NULL;
+
+        for (size_t j = 0; j < child->settings_count; j++) {
+            job.tasks[t++] = (json_parse_task_t){ children[i][j], &child->settings[j] };
+        }
+    }
+
+    for (unsigned int i = 0; i < threads; i++) {
+        job.docs[i] = json_doc_new(doc, NULL);
+        job.failed |= job.docs[i] == NULL;
+    }
+
+    json_parallel_for(task_count, threads, json_parse_task, &job);
+
+    /* Members parsed by the workers have their names interned in the worker documents */
+    for (size_t t = 0; t < task_count && !job.failed; t++) {
+        json_setting_t* set = *job.tasks[t].slot;
+        set->name = json_intern(doc, set->name, strlen(set->name));
+
+        if (set->type == Object && set->obj_type != NULL) {
+            json_rehome(set->obj_type, doc);
+        }
+    }
+
+    for (unsigned int i = 0; i < threads; i++) {
+        if (job.docs[i] != NULL) {
+            json_doc_release(job.docs[i]);
+        }
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (children[i] != NULL) {
+            json_free_double_char_array(children[i]);
+        }
+    }
+
+    json_dealloc(doc, children);
+    json_dealloc(doc, job.tasks);
+    json_dealloc(doc, job.docs);
+    json_free_double_char_array(settings);
+    json_record(doc, TraceParse, JSON_STATS_ENABLED ? strlen(str) : 0, start);
+    json_doc_release(doc);
+
+    if (job.failed) {
+        json_free(obj);
+        return NULL;
+    }
+
+    return obj;
+}
+
+/**
+ * Gets content of file into string
+ * @param fd valid file descriptor
+ * @return string containing file content
+ */
+char* json_get_file_content(int fd) {
+    off_t raw_len = lseek(fd, 0, SEEK_END);
+    char *raw_ptr = mmap(0, raw_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    char *file_content = json_malloc(NULL, raw_len + 1);
+    file_content[raw_len] = '\0';
+    strncpy(file_content, raw_ptr, raw_len);
+    munmap(raw_ptr, raw_len);
+
+    return file_content;
+}
+
+/**
+ * Read-only lookup table of a frozen object. Settings are moved into one contiguous block ordered by hash
+ * slot, and string values into one contiguous character block. Key names stay interned in the document.
+ */
+struct json_frozen_s {
+    json_setting_t* block;
+    char* strings;
+    unsigned int* seeds;
+    size_t bucket_count;
+};
+
+/**
+ * Gets the slot of a key in a frozen table for a given bucket seed
+ * @param hash Hash of the key
+ * @param seed Displacement seed of the key's bucket
+ * @param slot_count Number of slots in the table
+ * @return Slot index
+ */
+size_t json_frozen_slot(unsigned long long hash, unsigned int seed, size_t slot_count) {
+    return json_hash_mix(hash + (seed + 1) * 0x9e3779b97f4a7c15ULL) % slot_count;
+}
+
+/**
+ * Finds a setting in a frozen object, one hash probe and one name pointer comparison
+ * @param obj Frozen object to search
+ * @param key Interned name of the setting
+ * @param hash Hash of the name (json_hash_bytes)
+ * @return Corresponding setting or NULL if not found
+ */
+json_setting_t* json_frozen_find(json_obj_t* obj, const char* key, unsigned long long hash) {
+    if (obj->settings_count == 0) {
+        return NULL;
+    }
+
+    json_frozen_t* frozen = obj->frozen;
+    unsigned int seed = frozen->seeds[hash % frozen->bucket_count];
+    json_setting_t* setting = &frozen->block[json_frozen_slot(hash, seed, obj->settings_count)];
+
+    return setting->name == key ? setting : NULL;
+}
+
+/**
+ * Builds the minimal perfect hash of an object's keys (hash and displace). Keys are grouped in buckets,
+ * and starting with the biggest bucket, a seed is searched that sends every key of the bucket to a free slot.
+ * Duplicated keys only get the first occurrence hashed, like the linear lookup, and fill the remaining slots.
+ * @param obj Object to hash
+ * @param seeds Seeds per bucket, filled by the function
+ * @param bucket_count Number of buckets
+ * @param slots Slot of each setting, filled by the function
+ * @return 0 on failure, 1 on success
+ */
+int json_frozen_build(json_obj_t* obj, unsigned int* seeds, size_t bucket_count, size_t* slots) {
+    size_t n = obj->settings_count;
+    unsigned long long* hashes = json_malloc(obj->doc, sizeof(unsigned long long) * n);
+    size_t* offsets = json_calloc(obj->doc, bucket_count + 2, sizeof(size_t));
+    size_t* members = json_malloc(obj->doc, sizeof(size_t) * n);
+    size_t* order = json_malloc(obj->doc, sizeof(size_t) * bucket_count);
+    char* taken = json_calloc(obj->doc, n, 1);
+    int ret = 1;
+
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = json_hash_bytes(obj->settings[i]->name, strlen(obj->settings[i]->name));
+        offsets[hashes[i] % bucket_count + 2]++;
+        slots[i] = n;
+    }
+    for (size_t b = 0; b < bucket_count; b++) {
+        offsets[b + 2] += offsets[b + 1];
+        order[b] = b;
+    }
+    for (size_t i = 0; i < n; i++) {
+        members[offsets[hashes[i] % bucket_count + 1]++] = i;
+    }
+
+    /* Biggest buckets first, they are the hardest to place */
+    for (size_t b = 1; b < bucket_count; b++) {
+        size_t tmp = order[b];
+        size_t size = offsets[tmp + 1] - offsets[tmp];
+        size_t c = b;
+
+        for (; c > 0 && offsets[order[c - 1] + 1] - offsets[order[c - 1]] < size; c--) {
+            order[c] = order[c - 1];
+        }
+        order[c] = tmp;
+    }
+
+    for (size_t b = 0; b < bucket_count && ret; b++) {
+        size_t first = offsets[order[b]];
+        size_t last = offsets[order[b] + 1];
+        seeds[order[b]] = 0;
+
+        for (size_t i = first; i < last; i++) {
+            for (size_t j = first; j < i; j++) {
+                if (slots[members[j]] == n + 1 || hashes[members[i]] != hashes[members[j]]) {
+                    continue;
+                }
+                if (obj->settings[members[i]]->name == obj->settings[members[j]]->name) {
+                    slots[members[i]] = n + 1;
+                    break;
+                }
+            }
+        }
+
+        unsigned int seed = 0;
+        for (; seed < (1U << 20); seed++) {
+            size_t placed = first;
+
+            for (; placed < last; placed++) {
+                if (slots[members[placed]] == n + 1) {
+                    continue;
+                }
+
+                size_t slot = json_frozen_slot(hashes[members[placed]], seed, n);
+                if (taken[slot]) {
+                    break;
+                }
+                taken[slot] = 1;
+                slots[members[placed]] = slot;
+            }
+
+            if (placed == last) {
+                break;
+            }
+
+            for (size_t i = first; i < placed; i++) {
+                if (slots[members[i]] != n + 1) {
+                    taken[slots[members[i]]] = 0;
+                    slots[members[i]] = n;
+                }
+            }
+        }
+
+        if (seed == (1U << 20)) {
+            ret = 0;
+        }
+        seeds[order[b]] = seed;
+    }
+
+    for (size_t i = 0, free_slot = 0; i < n && ret; i++) {
+        if (slots[i] != n + 1) {
+            continue;
+        }
+        while (taken[free_slot]) {
+            free_slot++;
+        }
+        taken[free_slot] = 1;
+        slots[i] = free_slot;
+    }
+
+    json_dealloc(obj->doc, hashes);
+    json_dealloc(obj->doc, offsets);
+    json_dealloc(obj->doc, members);
+    json_dealloc(obj->doc, order);
+    json_dealloc(obj->doc, taken);
+    return ret;
+}
+
+/**
+ * Converts an object and all its sub-objects to a read-only form with constant time key lookups.
+ * Setters and removals on a frozen object fail. Freezing an already frozen object does nothing.
+ * @param obj Object to freeze
+ * @return 0 on failure, 1 on success
+ */
+int json_freeze(json_obj_t* obj) {
+    if (obj == NULL) {
+        return 0;
+    }
+    if (obj->frozen != NULL) {
+        return 1;
+    }
+
+    size_t n = obj->settings_count;
+    size_t strings_len = 1;
+    unsigned long long hash[2];
+
+    for (size_t i = 0; i < n; i++) {
+        json_setting_t* setting = obj->settings[i];
+
+        if (setting->type == Object && setting->obj_type != NULL && json_freeze(setting->obj_type) == 0) {
+            return 0;
+        }
+
+        if (setting->type == String) {
+            strings_len += strlen(setting->string_type) + 1;
+        }
+    }
+
+    json_doc_t* doc = obj->doc;
+    json_frozen_t* frozen = json_malloc(doc, sizeof(json_frozen_t));
+    size_t* slots = json_malloc(doc, sizeof(size_t) * (n + 1));
+
+    frozen->bucket_count = n / 2 + 1;
+    frozen->seeds = json_malloc(doc, sizeof(unsigned int) * frozen->bucket_count);
+
+    if (json_frozen_build(obj, frozen->seeds, frozen->bucket_count, slots) == 0) {
+        json_dealloc(doc, frozen->seeds);
+        json_dealloc(doc, frozen);
+        json_dealloc(doc, slots);
+        return 0;
+    }
+
+    frozen->block = json_malloc(doc, sizeof(json_setting_t) * (n + 1));
+    frozen->strings = json_malloc(doc, strings_len);
+
+    char* cursor = frozen->strings;
+    for (size_t i = 0; i < n; i++) {
+        json_setting_t* setting = obj->settings[i];
+        json_setting_t* dest = &frozen->block[slots[i]];
+
+        *dest = *setting;
+
+        if (setting->type == String) {
+            size_t len = strlen(setting->string_type) + 1;
+            dest->string_type = memcpy(cursor, setting->string_type, len);
+            json_set_string_cap(dest, len);
+            cursor += len;
+            json_dealloc(doc, setting->string_type);
+        }
+
+        json_dealloc(doc, setting);
+        obj->settings[i] = dest;
+    }
+
+    json_dealloc(doc, slots);
+    /* Frozen objects can be read from several threads, their hashes are cached before they are shared */
+    json_obj_hash(obj);
+    json_obj_hash128(obj, hash);
+    obj->frozen = frozen;
+    return 1;
+}
+
+/**
+ * Frees a JSON object. Objects shared between versions (see json_with_setting) are only freed with their
+ * last version.
+ * @param obj object to free
+ */
+void json_free(json_obj_t* obj) {
+    if (__atomic_sub_fetch(&obj->refcount, 1, __ATOMIC_ACQ_REL) > 0) {
+        return;
+    }
+
+    if (obj->frozen != NULL) {
+        for (size_t i = 0; i < obj->settings_count; i++) {
+            if (obj->settings[i]->type == Object && obj->settings[i]->obj_type != NULL) {
+                json_free(obj->settings[i]->obj_type);
+            }
+        }
+
+        json_dealloc(obj->doc, obj->frozen->block);
+        json_dealloc(obj->doc, obj->frozen->strings);
+        json_dealloc(obj->doc, obj->frozen->seeds);
+        json_dealloc(obj->doc, obj->frozen);
+    } else {
+        for (size_t i = 0; i < obj->settings_count; i++) {
+            json_free_setting(obj->doc, obj->settings[i]);
+        }
+    }
+
+    json_doc_t* doc = obj->doc;
+
+    json_dealloc(doc, obj->settings);
+    json_dealloc(doc, obj);
+    json_doc_release(doc);
+}
+
+/**
+ * Creates a new configuration object, creates necessary file if it doesn't exist.
+ * @param obj pointer to config object holder
+ * @param path path to the config file.
+ * @return -1 on error, 0 on success
+ */
+json_obj_t* json_from_file(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0600);
+
+    if (fd == -1) {
+        return NULL;
+    }
+
+    if (json_get_file_size(fd) == 0) {
+        write(fd, "{}", 2);
+    }
+
+    char* file_content = json_get_file_content(fd);
+    json_obj_t* obj = json_from_string(file_content);
+
+    json_dealloc(NULL, file_content);
+    close(fd);
+    return obj;
+}
+
+/**
+ * File of a batch load (see json_from_files)
+ */
+typedef struct json_batch_file_s {
+    int fd;
+    size_t size;
+    size_t read;
+    char* data;
+    struct iovec iov;
+    int reading;
+} json_batch_file_t;
+
+/**
+ * Opens a file of a batch load and allocates its buffer
+ * @param file File to open
+ * @param path Path of the file
+ * @return 0 on error, 1 on success
+ */
+int json_batch_open(json_batch_file_t* file, const char* path) {
+    struct stat s;
+
+    file->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (file->fd == -1) {
+        return 0;
+    }
+    if (fstat(file->fd, &s) != 0) {
+        close(file->fd);
+        return 0;
+    }
+
+    file->size = s.st_size;
+    file->read = 0;
+    file->data = json_malloc(NULL, file->size + 1);
+    return 1;
+}
+
+/**
+ * Closes a file of a batch load and parses its content. An empty file gives an empty object, as
+ * json_from_file does.
+ * @param file File whose content has been read
+ * @return The object, or NULL if unsuccessful
+ */
+json_obj_t* json_batch_parse(json_batch_file_t* file) {
+    json_obj_t* obj;
+
+    file->data[file->read] = '\0';
+    obj = json_from_string(file->read == 0 ? "{}" : file->data);
+
+    json_dealloc(NULL, file->data);
+    file->data = NULL;
+    close(file->fd);
+    return obj;
+}
+
+/**
+ * Shared state of a batch load
+ */
+typedef struct json_batch_s {
+    const char* const* paths;
+    json_obj_t** objs;
+    size_t loaded;
+} json_batch_t;
+
+/**
+ * Loads one file of a batch with pread, task of json_parallel_for
+ * @param index Index of the file
+ * @param ctx Batch (json_batch_t*)
+ * @param worker Unused
+ */
+void json_batch_task(size_t index, void* ctx, unsigned int worker) {
+    json_batch_t* batch = ctx;
+    json_batch_file_t file;
+    (void)worker;
+
+    batch->objs[index] = NULL;
+    if (!json_batch_open(&file, batch->paths[index])) {
+        return;
+    }
+
+    while (file.read < file.size) {
+        ssize_t n = pread(file.fd, file.data + file.read, file.size - file.read, file.read);
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        file.read += n;
+    }
+
+    batch->objs[index] = json_batch_parse(&file);
+    if (batch->objs[index] != NULL) {
+        __atomic_add_fetch(&batch->loaded, 1, __ATOMIC_RELAXED);
+    }
+}
+
+#ifdef JSON_IO_URING
+/**
+ * Maximum number of reads in flight during a batch load, which also bounds the number of open files
+ */
+#define JSON_URING_ENTRIES 64
+
+/**
+ * Submission and completion rings of an io_uring instance, used through raw system calls
+ */
+typedef struct json_uring_s {
+    int fd;
+    unsigned entries;
+    void* sq_ring;
+    size_t sq_len;
+    void* cq_ring;
+    size_t cq_len;
+    struct io_uring_sqe* sqes;
+    size_t sqes_len;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+} json_uring_t;
+
+/**
+ * Unmaps the rings and closes an io_uring instance
+ * @param ring Ring to close
+ */
+void json_uring_close(json_uring_t* ring) {
+    if (ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_len);
+    }
+    if (ring->cq_ring != MAP_FAILED && ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_len);
+    }
+    if (ring->sq_ring != MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_len);
+    }
+    close(ring->fd);
+}
+
+/**
+ * Sets up an io_uring instance
+ * @param ring Ring to set up
+ * @param entries Requested number of entries
+ * @return 0 if io_uring is unavailable, 1 on success
+ */
+int json_uring_open(json_uring_t* ring, unsigned entries) {
+    struct io_uring_params params;
+
+    memset(&params, 0, sizeof(params));
+    ring->fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return 0;
+    }
+
+    ring->entries = params.sq_entries;
+    ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    /* Kernels with IORING_FEAT_SINGLE_MMAP map both rings at once */
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->sq_len = ring->cq_len > ring->sq_len ? ring->cq_len : ring->sq_len;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                         IORING_OFF_SQ_RING);
+    ring->cq_ring = ring->sq_ring;
+    ring->sqes = MAP_FAILED;
+
+    if (ring->sq_ring != MAP_FAILED && !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+        ring->cq_ring = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                             IORING_OFF_CQ_RING);
+    }
+    if (ring->sq_ring != MAP_FAILED && ring->cq_ring != MAP_FAILED) {
+        ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+                          IORING_OFF_SQES);
+    }
+    if (ring->sqes == MAP_FAILED) {
+        json_uring_close(ring);
+        return 0;
+    }
+
+    ring->sq_tail = (unsigned*)((char*)ring->sq_ring + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)((char*)ring->sq_ring + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)((char*)ring->sq_ring + params.sq_off.array);
+    ring->cq_head = (unsigned*)((char*)ring->cq_ring + params.cq_off.head);
+    ring->cq_tail = (unsigned*)((char*)ring->cq_ring + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)((char*)ring->cq_ring + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)((char*)ring->cq_ring + params.cq_off.cqes);
+    return 1;
+}
+
+/**
+ * Queues the read of the rest of a file, submitted by the next io_uring_enter
+ * @param ring Ring
+ * @param file File to read
+ * @param index Index of the file, returned in the completion
+ */
+void json_uring_queue_read(json_uring_t* ring, json_batch_file_t* file, size_t index) {
+    unsigned tail = *ring->sq_tail;
+    unsigned slot = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[slot];
+
+    file->iov.iov_base = file->data + file->read;
+    file->iov.iov_len = file->size - file->read;
+
+    file->reading = 1;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = file->fd;
+    sqe->off = file->read;
+    sqe->addr = (unsigned long)&file->iov;
+    sqe->len = 1;
+    sqe->user_data = index;
+
+    ring->sq_array[slot] = slot;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * State of a batch load through io_uring: one task submits the reads, and the files whose read completed
+ * are queued for the other tasks, which parse them meanwhile
+ */
+typedef struct json_batch_uring_s {
+    json_batch_t* batch;
+    json_uring_t* ring;
+    json_batch_file_t* files;
+    size_t count;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t* ready;
+    size_t ready_count;
+    size_t taken;
+    int finished;
+} json_batch_uring_t;
+
+/**
+ * Queues a file for the parsing tasks: its read completed, or it must be read again with pread (closed
+ * file, fd set to -1)
+ * @param state Batch load
+ * @param index Index of the file
+ */
+void json_batch_ready(json_batch_uring_t* state, size_t index) {
+    pthread_mutex_lock(&state->lock);
+    state->ready[state->ready_count++] = index;
+    pthread_cond_signal(&state->cond);
+    pthread_mutex_unlock(&state->lock);
+}
+
+/**
+ * Submits the reads of a batch through io_uring. Files are opened as slots of the ring become free, and each
+ * file is queued for parsing as soon as its read completes, while the other reads are still in flight.
+ * @param state Batch load
+ */
+void json_batch_uring_read(json_batch_uring_t* state) {
+    json_uring_t* ring = state->ring;
+    json_batch_file_t* files = state->files;
+    json_batch_t* batch = state->batch;
+    size_t count = state->count;
+    size_t next = 0;
+    size_t done = 0;
+    unsigned in_flight = 0;
+    unsigned queued = 0;
+
+    while (done < count) {
+        /* Open the next files while there is room in the ring, empty files need no read */
+        while (next < count && in_flight + queued < ring->entries) {
+            size_t index = next++;
+
+            batch->objs[index] = NULL;
+            if (!json_batch_open(&files[index], batch->paths[index])) {
+                files[index].fd = -1;
+                done++;
+            } else if (files[index].size == 0) {
+                json_batch_ready(state, index);
+                done++;
+            } else {
+                json_uring_queue_read(ring, &files[index], index);
+                queued++;
+            }
+        }
+
+        if (in_flight + queued == 0) {
+            continue;
+        }
+
+        int submitted = syscall(__NR_io_uring_enter, ring->fd, queued, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            break;
+        }
+        if (submitted > 0) {
+            in_flight += submitted;
+            queued -= submitted;
+        }
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        for (; head != tail; head++) {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            json_batch_file_t* file = &files[cqe->user_data];
+            int res = cqe->res;
+
+            in_flight--;
+            if (res == -EINTR || res == -EAGAIN) {
+                json_uring_queue_read(ring, file, cqe->user_data);
+                queued++;
+                continue;
+            }
+
+            /* Short reads are continued, a file shrunk meanwhile is parsed as it is */
+            file->read += res > 0 ? res : 0;
+            if (res > 0 && file->read < file->size) {
+                json_uring_queue_read(ring, file, cqe->user_data);
+                queued++;
+                continue;
+            }
+
+            file->reading = 0;
+            if (res < 0) {
+                json_dealloc(NULL, file->data);
+                file->data = NULL;
+                close(file->fd);
+            } else {
+                json_batch_ready(state, cqe->user_data);
+            }
+            done++;
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    /*
+     * io_uring_enter failed: the reads in flight own their buffers until they complete. Completions are
+     * still posted to the ring, so when entering it keeps failing, it is polled between short sleeps.
+     */
+    while (done < count && in_flight > 0) {
+        int reaped = syscall(__NR_io_uring_enter, ring->fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (reaped < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            struct timespec pause = { 0, 1000000 };
+            nanosleep(&pause, NULL);
+        }
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+        in_flight -= tail - head;
+        __atomic_store_n(ring->cq_head, tail, __ATOMIC_RELEASE);
+    }
+
+    /*
+     * The files still being read (queued reads were never submitted) are read again with pread, like the
+     * files not opened yet. Files queued before are owned by the parsing tasks.
+     */
+    for (size_t i = 0; done < count && i < count; i++) {
+        if (i < next && !files[i].reading) {
+            continue;
+        }
+        if (i < next) {
+            json_dealloc(NULL, files[i].data);
+            files[i].data = NULL;
+            close(files[i].fd);
+        }
+        files[i].fd = -1;
+        json_batch_ready(state, i);
+    }
+
+    pthread_mutex_lock(&state->lock);
+    state->finished = 1;
+    pthread_cond_broadcast(&state->cond);
+    pthread_mutex_unlock(&state->lock);
+}
+
+/**
+ * Task of a batch load through io_uring: the first task submits the reads, the others parse the files
+ * queued by it until every file is handled
+ * @param index Index of the task
+ * @param ctx Batch load (json_batch_uring_t*)
+ * @param worker Index of the worker
+ */
+void json_batch_uring_task(size_t index, void* ctx, unsigned int worker) {
+    json_batch_uring_t* state = ctx;
+
+    if (index == 0) {
+        json_batch_uring_read(state);
+        return;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&state->lock);
+        while (state->taken == state->ready_count && !state->finished) {
+            pthread_cond_wait(&state->cond, &state->lock);
+        }
+        if (state->taken == state->ready_count) {
+            pthread_mutex_unlock(&state->lock);
+            return;
+        }
+        size_t file = state->ready[state->taken++];
+        pthread_mutex_unlock(&state->lock);
+
+        if (state->files[file].fd == -1) {
+            json_batch_task(file, state->batch, worker);
+        } else {
+            state->batch->objs[file] = json_batch_parse(&state->files[file]);
+        }
+    }
+}
+
+/**
+ * Loads a batch of files through io_uring, overlapping the reads with the parsing of the files already
+ * read on a pool of threads (see json_batch_uring_task)
+ * @param batch Batch to load
+ * @param count Number of files
+ * @return 0 if io_uring is unavailable (nothing was loaded), 1 otherwise
+ */
+int json_batch_uring(json_batch_t* batch, size_t count) {
+    json_uring_t ring;
+
+    if (!json_uring_open(&ring, count < JSON_URING_ENTRIES ? count : JSON_URING_ENTRIES)) {
+        return 0;
+    }
+
+    /* One task reads, mostly waiting for the kernel, and at least one other parses */
+    unsigned int threads = json_parallel_threads(0) + 1;
+    json_batch_uring_t state = {
+        .batch = batch,
+        .ring = &ring,
+        .files = json_calloc(NULL, count, sizeof(json_batch_file_t)),
+        .count = count,
+        .ready = json_malloc(NULL, sizeof(size_t) * count),
+    };
+
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.cond, NULL);
+
+    json_parallel_for(threads, threads, json_batch_uring_task, &state);
+
+    pthread_cond_destroy(&state.cond);
+    pthread_mutex_destroy(&state.lock);
+    json_uring_close(&ring);
+    json_dealloc(NULL, state.ready);
+    json_dealloc(NULL, state.files);
+    return 1;
+}
+#endif
+
+/**
+ * Loads several files at once. With io_uring (Linux) the reads of all the files are in flight together and
+ * each file is parsed on a pool of threads as soon as its read completes, otherwise the files are read with
+ * pread and parsed on a pool of threads. Files are loaded like json_from_file, but missing files are not created.
+ * @param paths Paths of the files
+ * @param count Number of files
+ * @param objs Array of count objects, receives the object of each file, or NULL for a file which could not
+ * be read or parsed
+ * @return Number of objects loaded
+ */
+size_t json_from_files(const char* const* paths, size_t count, json_obj_t** objs) {
+    json_batch_t batch = { paths, objs, 0 };
+
+    if (count == 0) {
+        return 0;
+    }
+
+#ifdef JSON_IO_URING
+    if (json_batch_uring(&batch, count)) {
+        batch.loaded = 0;
+        for (size_t i = 0; i < count; i++) {
+            batch.loaded += objs[i] != NULL;
+        }
+        return batch.loaded;
+    }
+#endif
+
+    json_parallel_for(count, json_parallel_threads(0), json_batch_task, &batch);
+    return batch.loaded;
+}
+
+/**
+ * Frees a string returned by the library (json_dump, json_dump_parallel)
+ * @param str String to free, can be NULL
+ */
+void json_free_string(char* str) {
+    json_dealloc(NULL, str);
+}
+
+/**
+ * Growing output buffer of the serializer
+ */
+typedef struct json_buf_s {
+    char* data;
+    size_t len;
+    size_t cap;
+    FILE* stream;
+    size_t written;
+    int failed;
+} json_buf_t;
+
+/**
+ * Size of the buffer of a serializer writing to a stream
+ */
+#define JSON_STREAM_BUFFER 65536
+
+/**
+ * Writes the content of a buffer to its stream and empties it, does nothing if the buffer has no stream
+ * @param buf Buffer to flush
+ */
+void json_buf_flush(json_buf_t* buf) {
+    if (buf->stream == NULL || buf->len == 0) {
+        return;
+    }
+
+    if (fwrite(buf->data, 1, buf->len, buf->stream) != buf->len) {
+        buf->failed = 1;
+    }
+
+    buf->written += buf->len;
+    buf->len = 0;
+}
+
+/**
+ * Makes room for at least extra more bytes (plus the terminating NUL) in a buffer. A buffer with a stream
+ * is flushed instead of growing, unless extra alone doesn't fit in it.
+ * @param buf Buffer to grow
+ * @param extra Number of bytes about to be appended
+ */
+void json_buf_reserve(json_buf_t* buf, size_t extra) {
+    if (buf->len + extra + 1 <= buf->cap) {
+        return;
+    }
+
+    json_buf_flush(buf);
+
+    if (buf->len + extra + 1 <= buf->cap) {
+        return;
+    }
+
+    size_t cap = buf->cap ? buf->cap : buf->stream != NULL ? JSON_STREAM_BUFFER : 64;
+    while (cap < buf->len + extra + 1) {
+        cap *= 2;
+    }
+
+    buf->data = json_realloc(NULL, buf->data, cap);
+    buf->cap = cap;
+}
+
+/**
+ * Appends bytes to a buffer, keeping it NUL-terminated
+ * @param buf Buffer to append to
+ * @param str Bytes to append
+ * @param len Number of bytes
+ */
+void json_buf_append(json_buf_t* buf, const char* str, size_t len) {
+    json_buf_reserve(buf, len);
+    memcpy(buf->data + buf->len, str, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+}
+
+/**
+ * Appends formatted text to a buffer
+ * @param buf Buffer to append to
+ * @param fmt printf format
+ */
+void json_buf_printf(json_buf_t* buf, const char* fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    int needed = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    json_buf_reserve(buf, needed);
+
+    va_start(args, fmt);
+    vsnprintf(buf->data + buf->len, needed + 1, fmt, args);
+    va_end(args);
+
+    buf->len += needed;
+}
+
+/**
+ * Appends a string between quotes, escaping quotes, backslashes and control characters. Runs of bytes
+ * without any of them are found by json_scan_escape and appended at once.
+ * @param buf Buffer to append to
+ * @param str String to append
+ */
+void json_buf_append_escaped(json_buf_t* buf, const char* str) {
+    static const char hex[] = "0123456789abcdef";
+    size_t len = strlen(str);
+
+    json_buf_append(buf, "\"", 1);
+
+    while (len > 0) {
+        size_t run = json_scan_escape(str, len);
+
+        json_buf_append(buf, str, run);
+        str += run;
+        len -= run;
+
+        if (len == 0) {
+            break;
+        }
+
+        char escape[6] = { '\\', *str, 0, 0, 0, 0 };
+        size_t escape_len = 2;
+
+        switch (*str) {
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            case '\"': case '\\': break;
+            default: {
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex[(unsigned char)*str >> 4];
+                escape[5] = hex[*str & 0xf];
+                escape_len = 6;
+            }
+        }
+
+        json_buf_append(buf, escape, escape_len);
+        str++;
+        len--;
+    }
+
+    json_buf_append(buf, "\"", 1);
+}
+
+void json_dump_object(json_buf_t* buf, json_obj_t* obj);
+void json_dump_pretty(json_buf_t* buf, json_obj_t* obj, const json_format_t* format, size_t depth);
+
+/**
+ * Serializes the value of a setting
+ * @param buf Buffer to write to
+ * @param setting Setting to serialize
+ * @param format Formatting options, NULL for a compact output
+ * @param depth Depth of the object holding the setting
+ */
+void json_dump_value(json_buf_t* buf, json_setting_t* setting, const json_format_t* format, size_t depth) {
+    switch (setting->type) {
+        case Boolean: {
+            json_buf_printf(buf, "%s", setting->bool_type ? "true" : "false");
+            break;
+        }
+        case Integer: {
+            json_buf_printf(buf, "%lld", setting->long_type);
+            break;
+        }
+        case Floating: {
+            json_buf_printf(buf, "%Lf", setting->double_type);
+            break;
+        }
+        case String: {
+            json_buf_append_escaped(buf, setting->string_type);
+            break;
+        }
+        case Object: {
+            if (setting->obj_type == NULL) {
+                json_buf_append(buf, "null", 4);
+            } else if (format == NULL) {
+                json_dump_object(buf, setting->obj_type);
+            } else {
+                json_dump_pretty(buf, setting->obj_type, format, depth);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Serializes a single setting as "key":value
+ * @param buf Buffer to write to
+ * @param setting Setting to serialize
+ */
+void json_dump_setting(json_buf_t* buf, json_setting_t* setting) {
+    json_buf_append_escaped(buf, setting->name);
+    json_buf_append(buf, ":", 1);
+    json_dump_value(buf, setting, NULL, 0);
+}
+
+/**
+ * Serializes an object without formatting
+ * @param buf Buffer to write to
+ * @param obj Object to serialize
+ */
+void json_dump_object(json_buf_t* buf, json_obj_t* obj) {
+    json_buf_append(buf, "{", 1);
+
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        if (i != 0) {
+            json_buf_append(buf, ",", 1);
+        }
+        json_dump_setting(buf, obj->settings[i]);
+    }
+
+    json_buf_append(buf, "}", 1);
+}
+
+/**
+ * Compares the names of two settings, for qsort
+ * @param a First setting (json_setting_t**)
+ * @param b Second setting (json_setting_t**)
+ * @return strcmp of the names
+ */
+int json_setting_name_cmp(const void* a, const void* b) {
+    return strcmp((*(json_setting_t* const*)a)->name, (*(json_setting_t* const*)b)->name);
+}
+
+/**
+ * Appends the indentation of a depth to a buffer
+ * @param buf Buffer to append to
+ * @param format Formatting options
+ * @param depth Depth of indentation
+ */
+void json_buf_indent(json_buf_t* buf, const json_format_t* format, size_t depth) {
+    size_t len = depth * format->indent;
+
+    json_buf_reserve(buf, len);
+    memset(buf->data + buf->len, format->indent_char, len);
+    buf->len += len;
+    buf->data[buf->len] = '\0';
+}
+
+/**
+ * Serializes an object with one setting per line, indented while traversing the tree
+ * @param buf Buffer to write to
+ * @param obj Object to serialize
+ * @param format Formatting options
+ * @param depth Depth of the object
+ */
+void json_dump_pretty(json_buf_t* buf, json_obj_t* obj, const json_format_t* format, size_t depth) {
+    if (obj->settings_count == 0) {
+        json_buf_append(buf, "{}", 2);
+        return;
+    }
+
+    json_setting_t** settings = obj->settings;
+
+    if (format->sort_keys) {
+        settings = json_malloc(NULL, sizeof(json_setting_t*) * obj->settings_count);
+        memcpy(settings, obj->settings, sizeof(json_setting_t*) * obj->settings_count);
+        qsort(settings, obj->settings_count, sizeof(json_setting_t*), json_setting_name_cmp);
+    }
+
+    json_buf_append(buf, "{\n", 2);
+
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        if (i != 0) {
+            json_buf_append(buf, ",\n", 2);
+        }
+        json_buf_indent(buf, format, depth + 1);
+        json_buf_append_escaped(buf, settings[i]->name);
+        json_buf_append(buf, ": ", 2);
+        json_dump_value(buf, settings[i], format, depth + 1);
+    }
+
+    json_buf_append(buf, "\n", 1);
+    json_buf_indent(buf, format, depth);
+    json_buf_append(buf, "}", 1);
+
+    if (settings != obj->settings) {
+        json_dealloc(NULL, settings);
+    }
+}
+
+/**
+ * Default formatting of json_dump, one tab per level
+ */
+const json_format_t json_default_format = { 1, '\t', 0 };
+
+/**
+ * Serializes an object into a buffer
+ * @param buf Buffer to write to, flushed to its stream if it has one
+ * @param obj Object to serialize
+ * @param format Formatting options, NULL for a compact output
+ */
+void json_dump_buf(json_buf_t* buf, json_obj_t* obj, const json_format_t* format) {
+    unsigned long long start = json_now_ns();
+
+    if (format == NULL) {
+        json_dump_object(buf, obj);
+    } else {
+        json_dump_pretty(buf, obj, format, 0);
+    }
+
+    json_buf_flush(buf);
+    json_record(obj->doc, TraceDump, buf->written + buf->len, start);
+}
+
+/**
+ * Creates a human readable string containing the given JSON object
+ * @param obj JSON object to dump
+ * @param format Boolean; Format the output with tabs (1) or no (0)
+ * @return JSON string, to free with json_free_string
+ */
+char* json_dump(json_obj_t* obj, int format) {
+    return json_dump_formatted(obj, format ? &json_default_format : NULL);
+}
+
+/**
+ * Creates a JSON string from an object, indented while it is serialized
+ * @param obj JSON object to dump
+ * @param format Formatting options (indentation, sorted keys), NULL for a compact output
+ * @return JSON string, to free with json_free_string
+ */
+char* json_dump_formatted(json_obj_t* obj, const json_format_t* format) {
+    json_buf_t buf = { 0 };
+
+    json_dump_buf(&buf, obj, format);
+    return buf.data;
+}
+
+/**
+ * Writes a JSON object to a stream, without building the whole string in memory first
+ * @param obj JSON object to dump
+ * @param stream Stream to write to
+ * @param format Formatting options (indentation, sorted keys), NULL for a compact output
+ * @return 0 on error, 1 on success
+ */
+int json_dump_file(json_obj_t* obj, FILE* stream, const json_format_t* format) {
+    json_buf_t buf = { 0 };
+
+    buf.stream = stream;
+    json_dump_buf(&buf, obj, format);
+    json_free_string(buf.data);
+
+    return !buf.failed;
+}
+
+/**
+ * Shared state of a parallel dump, one buffer per top level setting
+ */
+typedef struct json_dump_job_s {
+    json_obj_t* obj;
+    json_buf_t* parts;
+} json_dump_job_t;
+
+/**
+ * Serializes one top level setting of a parallel dump
+ * @param index Index of the setting
+ * @param ctx Job (json_dump_job_t*)
+ * @param worker Index of the worker (unused)
+ */
+void json_dump_task(size_t index, void* ctx, unsigned int worker) {
+    json_dump_job_t* job = ctx;
+
+    (void)worker;
+    json_dump_setting(&job->parts[index], job->obj->settings[index]);
+}
+
+/**
+ * Serializes the top level settings of an object concurrently into one buffer each
+ * @param obj Object to serialize
+ * @param threads Number of threads, 0 to use one per online processor
+ * @return Array of obj->settings_count buffers
+ */
+json_buf_t* json_dump_parts(json_obj_t* obj, unsigned int threads) {
+    json_dump_job_t job = { obj, json_calloc(NULL, obj->settings_count + 1, sizeof(json_buf_t)) };
+
+    json_parallel_for(obj->settings_count, json_parallel_threads(threads), json_dump_task, &job);
+
+    return job.parts;
+}
+
+/**
+ * Creates a compact JSON string from an object, serializing the top level settings on multiple threads.
+ * The output is identical to json_dump(obj, 0).
+ * @param obj JSON object to dump
+ * @param threads Number of threads, 0 to use one per online processor
+ * @return JSON string
+ */
+char* json_dump_parallel(json_obj_t* obj, unsigned int threads) {
+    unsigned long long start = json_now_ns();
+    json_buf_t* parts = json_dump_parts(obj, threads);
+    size_t len = 2 + (obj->settings_count ? obj->settings_count - 1 : 0);
+
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        len += parts[i].len;
+    }
+
+    char* str = json_malloc(NULL, len + 1);
+    size_t pos = 0;
+
+    str[pos++] = '{';
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        if (i != 0) {
+            str[pos++] = ',';
+        }
+        memcpy(str + pos, parts[i].data, parts[i].len);
+        pos += parts[i].len;
+        json_free_string(parts[i].data);
+    }
+    str[pos++] = '}';
+    str[pos] = '\0';
+
+    json_dealloc(NULL, parts);
+    json_record(obj->doc, TraceDump, len, start);
+    return str;
+}
+
+/**
+ * Prints a JSON object on the standard output. Memory handled
+ * @param obj Object to print
+ * @param format Boolean; Format the output (1) or no (0)?
+ */
+void json_print(json_obj_t* obj, int format) {
+    json_dump_file(obj, stdout, format ? &json_default_format : NULL);
+    printf("\n");
+}
+
+/**
+ * Writes a JSON object to disk
+ * @param json Object to save
+ * @param path Path to file that will contain the object
+ * @return 0 on error, 1 on success.
+ */
+int json_save(json_obj_t* json, const char* path) {
+    if (access(path, F_OK) == 0) {
+        if (unlink(path) == -1) {
+            return 0;
+        }
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+
+    if (fd == -1) {
+        return 0;
+    }
+
+    char* str = json_dump(json, 0);
+    write(fd, str, strlen(str));
+
+    json_free_string(str);
+    return 1;
+}
+
+/**
+ * Writes a JSON object to disk, serializing the top level settings on multiple threads. The serialized parts
+ * are written in place with pwritev at their precomputed offsets, without being concatenated first.
+ * The file content is identical to the one written by json_save.
+ * @param json Object to save
+ * @param path Path to file that will contain the object
+ * @param threads Number of threads, 0 to use one per online processor
+ * @return 0 on error, 1 on success.
+ */
+int json_save_parallel(json_obj_t* json, const char* path, unsigned int threads) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+
+    if (fd == -1) {
+        return 0;
+    }
+
+    unsigned long long start = json_now_ns();
+    json_buf_t* parts = json_dump_parts(json, threads);
+    size_t iov_count = json->settings_count * 2 + 1;
+    struct iovec* iov = json_malloc(NULL, sizeof(struct iovec) * (iov_count + 1));
+    int ret = 1;
+
+    iov[0] = (struct iovec){ "{", 1 };
+    for (size_t i = 0; i < json->settings_count; i++) {
+        iov[i * 2 + 1] = (struct iovec){ parts[i].data, parts[i].len };
+        iov[i * 2 + 2] = (struct iovec){ i == json->settings_count - 1 ? "}" : ",", 1 };
+    }
+    if (json->settings_count == 0) {
+        iov[1] = (struct iovec){ "}", 1 };
+        iov_count = 2;
+    }
+
+    off_t offset = 0;
+    for (size_t i = 0; i < iov_count && ret;) {
+        int batch = iov_count - i > IOV_MAX ? IOV_MAX : (int)(iov_count - i);
+        ssize_t written = pwritev(fd, &iov[i], batch, offset);
+
+        if (written == -1) {
+            ret = 0;
+            break;
+        }
+
+        offset += written;
+
+        /* Skip what was written, short writes resume in the middle of a part */
+        while (i < iov_count && (size_t)written >= iov[i].iov_len) {
+            written -= iov[i].iov_len;
+            i++;
+        }
+        if (i < iov_count) {
+            iov[i].iov_base = (char*)iov[i].iov_base + written;
+            iov[i].iov_len -= written;
+        }
+    }
+
+    for (size_t i = 0; i < json->settings_count; i++) {
+        json_free_string(parts[i].data);
+    }
+    json_dealloc(NULL, parts);
+    json_dealloc(NULL, iov);
+    close(fd);
+    json_record(json->doc, TraceDump, offset, start);
+    return ret;
+}
+
+/**
+ * Reads a whole file with read(2), without mapping it (the file may be truncated while being read)
+ * @param path Path of the file
+ * @return NUL-terminated content of the file, or NULL on error
+ */
+char* json_read_file(const char* path) {
+    int fd = open(path, O_RDONLY);
+
+    if (fd == -1) {
+        return NULL;
+    }
+
+    json_buf_t buf = { 0 };
+    json_buf_reserve(&buf, 4096);
+
+    for (;;) {
+        ssize_t n = read(fd, buf.data + buf.len, buf.cap - buf.len - 1);
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n == -1) {
+                json_free_string(buf.data);
+                buf.data = NULL;
+            }
+            break;
+        }
+
+        buf.len += n;
+        if (buf.len + 1 == buf.cap) {
+            json_buf_reserve(&buf, buf.cap);
+        }
+    }
+
+    if (buf.data != NULL) {
+        buf.data[buf.len] = '\0';
+    }
+
+    close(fd);
+    return buf.data;
+}
+
+/**
+ * Version of a watched document, referenced by the watcher while it's current and by every reader
+ */
+typedef struct json_watch_version_s {
+    json_obj_t* obj;
+    size_t refs;
+    struct json_watch_version_s* next;
+} json_watch_version_t;
+
+/**
+ * Watcher of a configuration file
+ */
+struct json_watch_s {
+    char* path;
+    const char* name;
+    unsigned int debounce_ms;
+    void (*on_reload)(json_obj_t* obj, void* ctx);
+    void (*on_error)(const char* message, void* ctx);
+    void* ctx;
+    int inotify_fd;
+    int stop_fds[2];
+    pthread_t thread;
+    pthread_mutex_t lock;
+    json_watch_version_t* current;
+    json_watch_version_t* versions;
+};
+
+/**
+ * Drops a reference on a version, frees it when it was the last one. The watcher lock must be held.
+ * @param watch Watcher owning the version
+ * @param version Version to release
+ */
+void json_watch_unref(json_watch_t* watch, json_watch_version_t* version) {
+    if (--version->refs > 0) {
+        return;
+    }
+
+    json_watch_version_t** link = &watch->versions;
+    while (*link != version) {
+        link = &(*link)->next;
+    }
+    *link = version->next;
+
+    json_free(version->obj);
+    json_dealloc(NULL, version);
+}
+
+/**
+ * Reports a reload that failed, the current version stays published
+ * @param watch Watcher
+ * @param message Description of the failure
+ */
+void json_watch_error(json_watch_t* watch, const char* message) {
+    if (watch->on_error != NULL) {
+        watch->on_error(message, watch->ctx);
+    }
+}
+
+/**
+ * Reloads the watched file, publishes it if its content changed
+ * @param watch Watcher
+ */
+void json_watch_reload(json_watch_t* watch) {
+    char* content = json_read_file(watch->path);
+
+    if (content == NULL) {
+        json_watch_error(watch, "can't read the watched file");
+        return;
+    }
+
+    json_obj_t* obj = json_from_string(content);
+    json_free_string(content);
+
+    if (obj == NULL) {
+        json_watch_error(watch, "can't parse the watched file");
+        return;
+    }
+
+    /* Unchanged content (or only whitespace / key order changes) is not published again */
+    if (watch->current != NULL) {
+        unsigned long long current[2];
+        unsigned long long hash[2];
+
+        json_obj_hash128(watch->current->obj, current);
+        json_obj_hash128(obj, hash);
+
+        if (current[0] == hash[0] && current[1] == hash[1]) {
+            json_free(obj);
+            return;
+        }
+    }
+
+    if (json_freeze(obj) == 0) {
+        json_free(obj);
+        json_watch_error(watch, "can't freeze the new version of the watched file");
+        return;
+    }
+
+    json_watch_version_t* version = json_malloc(NULL, sizeof(json_watch_version_t));
+    version->obj = obj;
+    version->refs = 2;
+
+    pthread_mutex_lock(&watch->lock);
+    json_watch_version_t* old = watch->current;
+    version->next = watch->versions;
+    watch->versions = version;
+    watch->current = version;
+    if (old != NULL) {
+        json_watch_unref(watch, old);
+    }
+    pthread_mutex_unlock(&watch->lock);
+
+    if (watch->on_reload != NULL) {
+        watch->on_reload(obj, watch->ctx);
+    }
+
+    pthread_mutex_lock(&watch->lock);
+    json_watch_unref(watch, version);
+    pthread_mutex_unlock(&watch->lock);
+}
+
+#ifdef __linux__
+/**
+ * Reads pending inotify events
+ * @param watch Watcher
+ * @return 1 if an event concerns the watched file, 0 otherwise
+ */
+int json_watch_read_events(json_watch_t* watch) {
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    int relevant = 0;
+    ssize_t len;
+
+    while ((len = read(watch->inotify_fd, events, sizeof(events))) > 0) {
+        for (char* ptr = events; ptr < events + len;) {
+            struct inotify_event* event = (struct inotify_event*)ptr;
+
+            if (event->len > 0 && strcmp(event->name, watch->name) == 0) {
+                relevant = 1;
+            }
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return relevant;
+}
+
+/**
+ * Thread routine of a watcher: waits for changes of the file, waits for the writes to settle, reloads
+ * @param arg Watcher (json_watch_t*)
+ * @return NULL
+ */
+void* json_watch_routine(void* arg) {
+    json_watch_t* watch = arg;
+    struct pollfd fds[2] = { { watch->inotify_fd, POLLIN, 0 }, { watch->stop_fds[0], POLLIN, 0 } };
+    struct timespec deadline = { 0, 0 };
+    int pending = 0;
+
+    for (;;) {
+        int timeout = -1;
+
+        /* Events on other files of the directory don't move the deadline of a pending reload */
+        if (pending) {
+            struct timespec now;
+
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long remaining = (deadline.tv_sec - now.tv_sec) * 1000LL + (deadline.tv_nsec - now.tv_nsec) / 1000000;
+            timeout = remaining > 0 ? (int)remaining : 0;
+        }
+
+        int ready = timeout == 0 ? 0 : poll(fds, 2, timeout);
+
+        if (ready == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ready == -1 || fds[1].revents) {
+            return NULL;
+        }
+
+        if (ready == 0) {
+            pending = 0;
+            json_watch_reload(watch);
+            continue;
+        }
+
+        /* A new event on the watched file restarts the debounce delay */
+        if (json_watch_read_events(watch)) {
+            pending = 1;
+            clock_gettime(CLOCK_MONOTONIC, &deadline);
+            deadline.tv_sec += watch->debounce_ms / 1000;
+            deadline.tv_nsec += (long)(watch->debounce_ms % 1000) * 1000000;
+            if (deadline.tv_nsec >= 1000000000) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000;
+            }
+        }
+    }
+}
+#endif
+
+/**
+ * Watches a configuration file and reloads it in the background when it changes. Bursts of writes are
+ * debounced, and a new version is only published when its content actually changed. Published versions are
+ * frozen, readers get the current one with json_watch_acquire and never wait for a reload.
+ * @param path Path of the file to watch
+ * @param debounce_ms Delay without any write to the file before it's reloaded
+ * @param on_reload Function called from the watcher thread when a new version is published, can be NULL
+ * @param on_error Function called when the file can't be loaded, the current version is kept. Called from
+ * the watcher thread, and from json_watch for the first load. Can be NULL
+ * @param ctx Context passed to on_reload and on_error
+ * @return The watcher, or NULL on error (or if inotify isn't available)
+ */
+json_watch_t* json_watch(const char* path, unsigned int debounce_ms, void (*on_reload)(json_obj_t* obj, void* ctx),
+                         void (*on_error)(const char* message, void* ctx), void* ctx) {
+#ifdef __linux__
+    json_watch_t* watch = json_calloc(NULL, 1, sizeof(json_watch_t));
+    const char* slash = strrchr(path, '/');
+
+    watch->path = json_malloc(NULL, strlen(path) + 1);
+    strcpy(watch->path, path);
+    watch->name = slash != NULL ? watch->path + (slash - path) + 1 : watch->path;
+    watch->debounce_ms = debounce_ms;
+    watch->on_reload = on_reload;
+    watch->on_error = on_error;
+    watch->ctx = ctx;
+    watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    pthread_mutex_init(&watch->lock, NULL);
+
+    /* The directory is watched, editors often replace the file instead of writing to it */
+    char* dir = json_malloc(NULL, strlen(path) + 2);
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    } else if (slash == path) {
+        strcpy(dir, "/");
+    } else {
+        memcpy(dir, path, slash - path);
+        dir[slash - path] = '\0';
+    }
+
+    uint32_t mask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+    int ok = watch->inotify_fd != -1 && inotify_add_watch(watch->inotify_fd, dir, mask) != -1;
+    json_dealloc(NULL, dir);
+
+    if (ok && pipe(watch->stop_fds) == 0) {
+        json_watch_reload(watch);
+
+        if (pthread_create(&watch->thread, NULL, json_watch_routine, watch) == 0) {
+            return watch;
+        }
+
+        close(watch->stop_fds[0]);
+        close(watch->stop_fds[1]);
+    }
+
+    if (watch->current != NULL) {
+        json_watch_unref(watch, watch->current);
+    }
+    if (watch->inotify_fd != -1) {
+        close(watch->inotify_fd);
+    }
+    pthread_mutex_destroy(&watch->lock);
+    json_dealloc(NULL, watch->path);
+    json_dealloc(NULL, watch);
+#else
+    (void)path;
+    (void)debounce_ms;
+    (void)on_reload;
+    (void)on_error;
+    (void)ctx;
+#endif
+    return NULL;
+}
+
+/**
+ * Gets the current version of a watched file. The version stays valid, even after newer versions are
+ * published, until it's released with json_watch_release.
+ * @param watch Watcher
+ * @return Current (frozen) object, or NULL if the file couldn't be loaded yet
+ */
+json_obj_t* json_watch_acquire(json_watch_t* watch) {
+    json_obj_t* obj = NULL;
+
+    pthread_mutex_lock(&watch->lock);
+    if (watch->current != NULL) {
+        watch->current->refs++;
+        obj = watch->current->obj;
+    }
+    pthread_mutex_unlock(&watch->lock);
+
+    return obj;
+}
+
+/**
+ * Releases a version obtained with json_watch_acquire
+ * @param watch Watcher
+ * @param obj Object to release, can be NULL
+ */
+void json_watch_release(json_watch_t* watch, json_obj_t* obj) {
+    if (obj == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&watch->lock);
+    json_watch_version_t* version = watch->versions;
+    while (version != NULL && version->obj != obj) {
+        version = version->next;
+    }
+    if (version != NULL) {
+        json_watch_unref(watch, version);
+    }
+    pthread_mutex_unlock(&watch->lock);
+}
+
+/**
+ * Stops watching a file and frees the watcher. Every acquired version must have been released.
+ * @param watch Watcher to stop
+ */
+void json_watch_stop(json_watch_t* watch) {
+    if (watch == NULL) {
+        return;
+    }
+
+    write(watch->stop_fds[1], "", 1);
+    pthread_join(watch->thread, NULL);
+
+    while (watch->versions != NULL) {
+        json_watch_version_t* next = watch->versions->next;
+        json_free(watch->versions->obj);
+        json_dealloc(NULL, watch->versions);
+        watch->versions = next;
+    }
+
+    close(watch->stop_fds[0]);
+    close(watch->stop_fds[1]);
+    close(watch->inotify_fd);
+    pthread_mutex_destroy(&watch->lock);
+    json_dealloc(NULL, watch->path);
+    json_dealloc(NULL, watch);
+}
+
+/**
+ * Background saver of an object (see json_saver_start)
+ */
+struct json_saver_s {
+    json_obj_t* obj;
+    char* path;
+    char* tmp_path;
+    json_saver_options_t options;
+    json_format_t format;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t dirty_cond;
+    pthread_cond_t saved_cond;
+    unsigned long long dirty;
+    unsigned long long saved;
+    unsigned long long last_ok_ticket;
+    int stopping;
+};
+
+/**
+ * Writes data to a file atomically: the data is written to a temporary file which then replaces the file,
+ * so that readers never see a partially written file
+ * @param path Path of the file
+ * @param tmp_path Path of the temporary file, in the same directory
+ * @param data Data to write
+ * @param len Length of the data
+ * @param sync Boolean; flush the file and its directory to the disk
+ * @return 0 on error, 1 on success
+ */
+int json_write_atomic(const char* path, const char* tmp_path, const char* data, size_t len, int sync) {
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    int ok = fd != -1;
+
+    for (size_t written = 0; ok && written < len;) {
+        ssize_t n = write(fd, data + written, len - written);
+
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        ok = n > 0;
+        written += ok ? (size_t)n : 0;
+    }
+
+    if (ok && sync) {
+        ok = fsync(fd) == 0;
+    }
+    if (fd != -1 && close(fd) != 0) {
+        ok = 0;
+    }
+    if (ok) {
+        ok = rename(tmp_path, path) == 0;
+    } else if (fd != -1) {
+        unlink(tmp_path);
+    }
+
+    /* The rename itself is only durable once the directory is flushed */
+    if (ok && sync) {
+        const char* slash = strrchr(path, '/');
+        char* dir = json_malloc(NULL, strlen(path) + 2);
+
+        if (slash == NULL) {
+            strcpy(dir, ".");
+        } else {
+            memcpy(dir, path, slash == path ? 1 : slash - path);
+            dir[slash == path ? 1 : slash - path] = '\0';
+        }
+
+        int dir_fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        ok = dir_fd != -1 && fsync(dir_fd) == 0;
+
+        if (dir_fd != -1) {
+            close(dir_fd);
+        }
+        json_dealloc(NULL, dir);
+    }
+
+    return ok;
+}
+
+/**
+ * Thread routine of a saver: waits for the object to be marked dirty, waits for the minimum interval since
+ * the previous save (coalescing every request made meanwhile), then snapshots and writes the object
+ * @param arg Saver (json_saver_t*)
+ * @return NULL
+ */
+void* json_saver_routine(void* arg) {
+    json_saver_t* saver = arg;
+    struct timespec last = { 0, 0 };
+
+    pthread_mutex_lock(&saver->lock);
+
+    for (;;) {
+        while (saver->dirty == saver->saved && !saver->stopping) {
+            pthread_cond_wait(&saver->dirty_cond, &saver->lock);
+        }
+        if (saver->dirty == saver->saved) {
+            break;
+        }
+
+        /* Rate limiting, skipped when stopping so that the last changes are written right away */
+        struct timespec next = last;
+        next.tv_sec += saver->options.min_interval_ms / 1000;
+        next.tv_nsec += (long)(saver->options.min_interval_ms % 1000) * 1000000;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000;
+        }
+
+        while (!saver->stopping && pthread_cond_timedwait(&saver->dirty_cond, &saver->lock, &next) != ETIMEDOUT) {
+        }
+
+        unsigned long long ticket = saver->dirty;
+        pthread_mutex_unlock(&saver->lock);
+
+        json_buf_t buf = { 0 };
+
+        if (saver->options.lock != NULL) {
+            saver->options.lock(saver->options.ctx);
+        }
+        json_dump_buf(&buf, saver->obj, saver->options.format != NULL ? &saver->format : NULL);
+        if (saver->options.unlock != NULL) {
+            saver->options.unlock(saver->options.ctx);
+        }
+
+        int ok = json_write_atomic(saver->path, saver->tmp_path, buf.data, buf.len, saver->options.sync);
+        json_free_string(buf.data);
+        clock_gettime(CLOCK_MONOTONIC, &last);
+
+        if (saver->options.on_saved != NULL) {
+            saver->options.on_saved(ticket, ok, saver->options.ctx);
+        }
+
+        pthread_mutex_lock(&saver->lock);
+        saver->saved = ticket;
+        saver->last_ok_ticket = ok ? ticket : saver->last_ok_ticket;
+        pthread_cond_broadcast(&saver->saved_cond);
+    }
+
+    pthread_mutex_unlock(&saver->lock);
+    return NULL;
+}
+
+/**
+ * Starts saving an object in the background: every json_saver_mark_dirty requests a save, and requests
+ * made while a save is pending or running are coalesced into the next one. The object is written to a
+ * temporary file (path followed by ".tmp") which then replaces the file. The saver doesn't take a reference
+ * on the object: references tell versions which objects they share (see json_with_setting), so the object
+ * must rather be kept alive by the caller until json_saver_stop.
+ * @param obj Object to save
+ * @param path Path of the file
+ * @param options Options (rate limiting, fsync, format, callbacks), copied by the call, NULL for defaults
+ * @return The saver, or NULL on error
+ */
+json_saver_t* json_saver_start(json_obj_t* obj, const char* path, const json_saver_options_t* options) {
+    if (obj == NULL || path == NULL) {
+        return NULL;
+    }
+
+    json_saver_t* saver = json_calloc(NULL, 1, sizeof(json_saver_t));
+    pthread_condattr_t attr;
+
+    saver->obj = obj;
+    saver->path = json_malloc(NULL, strlen(path) + 1);
+    strcpy(saver->path, path);
+    saver->tmp_path = json_malloc(NULL, strlen(path) + 5);
+    strcpy(saver->tmp_path, path);
+    strcat(saver->tmp_path, ".tmp");
+
+    if (options != NULL) {
+        saver->options = *options;
+        saver->format = options->format != NULL ? *options->format : saver->format;
+    }
+
+    pthread_mutex_init(&saver->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&saver->dirty_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_cond_init(&saver->saved_cond, NULL);
+
+    if (pthread_create(&saver->thread, NULL, json_saver_routine, saver) != 0) {
+        pthread_cond_destroy(&saver->dirty_cond);
+        pthread_cond_destroy(&saver->saved_cond);
+        pthread_mutex_destroy(&saver->lock);
+        json_dealloc(NULL, saver->tmp_path);
+        json_dealloc(NULL, saver->path);
+        json_dealloc(NULL, saver);
+        return NULL;
+    }
+
+    return saver;
+}
+
+/**
+ * Requests a save of the object, without waiting for it
+ * @param saver Saver
+ * @return Ticket of the request, to pass to json_saver_wait (tickets are also given to the on_saved callback,
+ * a save covers every ticket up to its own)
+ */
+unsigned long long json_saver_mark_dirty(json_saver_t* saver) {
+    pthread_mutex_lock(&saver->lock);
+    unsigned long long ticket = ++saver->dirty;
+    pthread_cond_signal(&saver->dirty_cond);
+    pthread_mutex_unlock(&saver->lock);
+
+    return ticket;
+}
+
+/**
+ * Waits for a requested save to be written
+ * @param saver Saver
+ * @param ticket Ticket returned by json_saver_mark_dirty
+ * @return 0 if the save covering the ticket failed (and no later save succeeded yet) or if the ticket wasn't
+ * returned by json_saver_mark_dirty yet, 1 on success
+ */
+int json_saver_wait(json_saver_t* saver, unsigned long long ticket) {
+    pthread_mutex_lock(&saver->lock);
+
+    /* Nothing would ever save a ticket that wasn't issued */
+    if (ticket > saver->dirty) {
+        pthread_mutex_unlock(&saver->lock);
+        return 0;
+    }
+
+    while (saver->saved < ticket) {
+        pthread_cond_wait(&saver->saved_cond, &saver->lock);
+    }
+
+    /* A successful save covers every ticket up to its own, even tickets of failed saves before it */
+    int ok = ticket <= saver->last_ok_ticket;
+    pthread_mutex_unlock(&saver->lock);
+    return ok;
+}
+
+/**
+ * Stops a saver, writing the pending changes first without waiting for the minimum interval
+ * @param saver Saver to stop, can be NULL
+ * @return 0 if the last save failed, 1 on success
+ */
+int json_saver_stop(json_saver_t* saver) {
+    if (saver == NULL) {
+        return 1;
+    }
+
+    pthread_mutex_lock(&saver->lock);
+    saver->stopping = 1;
+    pthread_cond_signal(&saver->dirty_cond);
+    pthread_mutex_unlock(&saver->lock);
+
+    pthread_join(saver->thread, NULL);
+
+    int ok = saver->last_ok_ticket == saver->saved;
+
+    pthread_cond_destroy(&saver->dirty_cond);
+    pthread_cond_destroy(&saver->saved_cond);
+    pthread_mutex_destroy(&saver->lock);
+    json_dealloc(NULL, saver->tmp_path);
+    json_dealloc(NULL, saver->path);
+    json_dealloc(NULL, saver);
+    return ok;
+}
+
+/**
+ * Finds a setting by name in a single object
+ * @param obj Object to search
+ * @param key Name of the setting, not necessarily NUL-terminated
+ * @param len Length of the name
+ * @return Corresponding setting or NULL if not found
+ */
+json_setting_t* json_obj_find(json_obj_t* obj, const char* key, size_t len) {
+    unsigned long long hash = json_hash_bytes(key, len);
+    char* name = json_intern_find(obj->doc, key, len, hash);
+
+    if (name == NULL) {
+        return NULL;
+    }
+
+    if (obj->frozen != NULL) {
+        return json_frozen_find(obj, name, hash);
+    }
+
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        if (obj->settings[i]->name == name) {
+            return obj->settings[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Walks a key path without splitting it, to the object that holds (or would hold) the last key
+ * @param obj Object to search
+ * @param key Key path (ex: "object.setting")
+ * @param separator Char separator separating the keys in the path
+ * @param parent Set to the object holding the last key, or NULL if the path is invalid or an object on it doesn't exist
+ * @param last Set to the last key of the path, not NUL-terminated relative to the path
+ * @param last_len Set to the length of the last key
+ * @return Corresponding setting or NULL if not found
+ */
+json_setting_t* json_walk_path(json_obj_t* obj, const char* key, char separator, json_obj_t** parent,
+                               const char** last, size_t* last_len) {
+    *parent = NULL;
+
+    while (obj != NULL) {
+        const char* end = strchr(key, separator);
+        size_t len = end != NULL ? (size_t)(end - key) : strlen(key);
+
+        if (len == 0) {
+            return NULL;
+        }
+
+        json_setting_t* setting = json_obj_find(obj, key, len);
+
+        if (end == NULL) {
+            *parent = obj;
+            *last = key;
+            *last_len = len;
+            return setting;
+        }
+
+        if (setting == NULL || setting->type != Object) {
+            return NULL;
+        }
+
+        obj = setting->obj_type;
+        key = end + 1;
+    }
+
+    return NULL;
+}
+
+/**
+ * Removes the setting at an index of an object, keeping the order of the other settings
+ * @param obj Object to remove from
+ * @param index Index of the setting
+ * @return The removed setting
+ */
+json_setting_t* json_obj_remove_at(json_obj_t* obj, size_t index) {
+    json_setting_t* setting = obj->settings[index];
+
+    memmove(&obj->settings[index], &obj->settings[index + 1], sizeof(json_setting_t*) * (obj->settings_count - index - 1));
+    obj->settings_count--;
+
+    return setting;
+}
+
+/**
+ * Gets the index of a setting in its object
+ * @param obj Object holding the setting
+ * @param setting Setting to search
+ * @return Index of the setting
+ */
+size_t json_obj_index(json_obj_t* obj, json_setting_t* setting) {
+    size_t i = 0;
+
+    while (obj->settings[i] != setting) {
+        i++;
+    }
+
+    return i;
+}
+
+/**
+ * Gets the setting at a key path, counting the lookup in the statistics of the object's document
+ * @param obj Object to search
+ * @param key Key path (ex: "object.setting")
+ * @param separator Char separator separating the keys in the path
+ * @return Corresponding setting or NULL if not found
+ */
+json_setting_t* json_lookup(json_obj_t* obj, const char* key, char separator) {
+    json_obj_t* parent;
+    const char* last;
+    size_t last_len;
+
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    json_setting_t* setting = json_walk_path(obj, key, separator, &parent, &last, &last_len);
+
+#ifdef JSON_STATS
+    size_t depth = 1;
+
+    for (const char* c = key; *c != '\0'; c++) {
+        depth += *c == separator;
+    }
+
+    JSON_STAT(obj->doc, lookups, 1);
+    JSON_STAT(obj->doc, lookup_depth, depth);
+
+    if (setting == NULL) {
+        JSON_STAT(obj->doc, lookup_misses, 1);
+        json_trace(TraceLookupMiss, 0, 0, key);
+    }
+#endif
+    return setting;
+}
+
+/**
+ * Get corresponding string setting
+ * @param obj Object to search
+ * @param str Key array like (ex: "object.setting")
+ * @param separator Char separator separating the keys in the string
+ * @return Corresponding setting or NULL if error happens
+ */
+char* json_get_string(json_obj_t* obj, const char* str, char separator) {
+    json_setting_t* setting = json_lookup(obj, str, separator);
+
+    if (setting == NULL || setting->type != String) {
+        printf("error: can't find %s, or it isn't a string\n", str);
+        return NULL;
+    }
+
+    return setting->string_type;
+}
+
+/**
+ * Get corresponding boolean setting
+ * @param obj Object to search
+ * @param str Key array like (ex: "object.setting")
+ * @param separator Char separator separating the keys in the string (ex: '.')
+ * @return Correct boolean value or 0 if nothing is found
+ */
+int json_get_bool(json_obj_t* obj, const char* str, char separator) {
+    json_setting_t* setting = json_lookup(obj, str, separator);
+
+    if (setting == NULL || setting->type != Boolean) {
+        printf("error: can't find %s, or it isn't a bool\n", str);
+        return 0;
+    }
+
+    return setting->bool_type;
+}
+
+/**
+ * Get corresponding integer setting
+ * @param obj Object to search
+ * @param str Key array like (ex: "object.setting")
+ * @param separator Char separator separating the keys in the string (ex: '.')
+ * @return Corresponding setting or 0 if error happens
+ */
+long long json_get_integer(json_obj_t* obj, const char* str, char separator) {
+    json_setting_t* setting = json_lookup(obj, str, separator);
+
+    if (setting == NULL || setting->type != Integer) {
+        printf("error: can't find %s, or it isn't an integer\n", str);
+        return 0;
+    }
+
+    return setting->long_type;
+}
+
+/**
+ * Get corresponding object setting
+ * @param obj Object to search
+ * @param str Key array like (ex: "object.setting")
+ * @param separator Char separator separating the keys in the string (ex: '.')
+ * @return Corresponding setting or NULL if error happens
+ */
+json_obj_t* json_get_object(json_obj_t* obj, const char* str, char separator) {
+    json_setting_t* setting = json_lookup(obj, str, separator);
+
+    if (setting == NULL || setting->type != Object) {
+        printf("error: can't find %s, or it isn't an object\n", str);
+        return NULL;
+    }
+
+    return setting->obj_type;
+}
+
+/**
+ * Get corresponding floating point number setting
+ * @param obj Object to search
+ * @param str Key array like (ex: "object.setting")
+ * @param separator Char separator separating the keys in the string (ex: '.')
+ * @return Corresponding value or 0 if error happens
+ */
+long double json_get_floating(json_obj_t* obj, const char* str, char separator) {
+    json_setting_t* setting = json_lookup(obj, str, separator);
+
+    if (setting == NULL || setting->type != Floating) {
+        printf("error: can't find %s, or it isn't a floating point number\n", str);
+        return 0;
+    }
+
+    return setting->double_type;
+}
+
+/**
+ * Copies a single object, sharing its sub-objects with the original (their reference count is incremented)
+ * @param obj Object to copy
+ * @param doc Document of the copy, its key names and strings are allocated in it
+ * @return The copy, never frozen
+ */
+json_obj_t* json_copy_node(json_obj_t* obj, json_doc_t* doc) {
+    json_obj_t* copy = json_new_object(doc);
+    int same_doc = doc == obj->doc && obj->frozen == NULL;
+
+    copy->settings_count = obj->settings_count;
+    copy->settings = json_malloc(doc, sizeof(json_setting_t*) * (obj->settings_count + 1));
+    copy->hash = obj->hash;
+    copy->hash_generation = same_doc ? obj->hash_generation : 0;
+    copy->hash128[0] = obj->hash128[0];
+    copy->hash128[1] = obj->hash128[1];
+    copy->hash128_generation = same_doc ? obj->hash128_generation : 0;
+
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        json_setting_t* setting = json_malloc(doc, sizeof(json_setting_t));
+
+        *setting = *obj->settings[i];
+
+        if (doc != obj->doc) {
+            setting->name = json_intern(doc, setting->name, strlen(setting->name));
+        }
+
+        if (setting->type == String) {
+            size_t len = strlen(setting->string_type) + 1;
+            setting->string_type = memcpy(json_malloc(doc, len), setting->string_type, len);
+            json_set_string_cap(setting, len);
+        } else if (setting->type == Object && setting->obj_type != NULL) {
+            __atomic_add_fetch(&setting->obj_type->refcount, 1, __ATOMIC_RELAXED);
+        }
+
+        copy->settings[i] = setting;
+    }
+
+    return copy;
+}
+
+/**
+ * Gives an object setting a copy of its object when the object is shared with other versions (see
+ * json_with_setting), so that it can be modified in place. The copy belongs to the document of the holder.
+ * @param holder Object holding the setting
+ * @param setting Object setting of holder
+ * @return The object of the setting, only referenced by holder
+ */
+json_obj_t* json_unshare(json_obj_t* holder, json_setting_t* setting) {
+    json_obj_t* obj = setting->obj_type;
+
+    if (__atomic_load_n(&obj->refcount, __ATOMIC_ACQUIRE) > 1) {
+        setting->obj_type = json_copy_node(obj, holder->doc);
+        json_free(obj);
+    }
+
+    return setting->obj_type;
+}
+
+/**
+ * Invalidates the cached hashes of an object about to be modified in place. The objects holding it must be
+ * invalidated too: when the modification doesn't go through them, a parent may have cached its hash and the
+ * generation of the document is incremented instead.
+ * @param obj Object about to be modified
+ * @param root Whether obj is the object through which the modification is made
+ */
+void json_invalidate_hash(json_obj_t* obj, int root) {
+    if (root && obj->hash_observed) {
+        obj->doc->generation++;
+    }
+
+    obj->hash_generation = 0;
+    obj->hash128_generation = 0;
+}
+
+/**
+ * Prepares the objects on a key path for the modification of the last one in place: shared objects are
+ * unshared (see json_unshare) and cached hashes are invalidated, the hashes of other objects stay cached
+ * @param obj Root object, modified in place by its owner
+ * @param key Key path whose parents exist (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ */
+void json_modify_path(json_obj_t* obj, const char* key, char separator) {
+    json_invalidate_hash(obj, 1);
+
+    for (const char* end = strchr(key, separator); end != NULL; end = strchr(key, separator)) {
+        obj = json_unshare(obj, json_obj_find(obj, key, end - key));
+        json_invalidate_hash(obj, 0);
+        key = end + 1;
+    }
+}
+
+/**
+ * Removes a setting from an object at specified key
+ * @param obj Object to search in
+ * @param key Key to setting
+ * @param separator Separator
+ * @return 0 if obj is NULL, if setting doesn't exist, 1 on success
+ */
+int json_remove_setting(json_obj_t* obj, const char* key, char separator) {
+    if (obj == NULL) {
+        return 0;
+    }
+
+    json_obj_t* parent;
+    const char* last;
+    size_t last_len;
+    json_setting_t* setting = json_walk_path(obj, key, separator, &parent, &last, &last_len);
+
+    if (setting == NULL || parent->frozen != NULL) {
+        return 0;
+    }
+
+    json_modify_path(obj, key, separator);
+    setting = json_walk_path(obj, key, separator, &parent, &last, &last_len);
+
+    json_free_setting(parent->doc, json_obj_remove_at(parent, json_obj_index(parent, setting)));
+
+    return 1;
+}
+
+/**
+ * Writes a value into the setting of an object. An existing setting is overwritten in place, keeping its
+ * position in the object and reusing its string buffer when the new string fits in it. A new setting is
+ * appended to the object.
+ * @param parent Object holding the setting
+ * @param setting Existing setting, or NULL to append a new one
+ * @param name Name of the new setting, not necessarily NUL-terminated
+ * @param name_len Length of the name
+ * @param update Type and value to set, a String value is copied and an Object value is owned on success
+ * @return 0 on failure, 1 on success
+ */
+int json_update_setting(json_obj_t* parent, json_setting_t* setting, const char* name, size_t name_len,
+                        const json_setting_t* update) {
+    if (setting == NULL) {
+        json_setting_t** settings = json_realloc(parent->doc, parent->settings, sizeof(json_setting_t*) * (parent->settings_count + 1));
+
+        if (settings == NULL) {
+            return 0;
+        }
+
+        setting = json_malloc(parent->doc, sizeof(json_setting_t));
+        setting->name = json_intern(parent->doc, name, name_len);
+        setting->type = Boolean;
+        parent->settings = settings;
+        parent->settings[parent->settings_count++] = setting;
+    }
+
+    if (setting->type == Object && setting->obj_type != NULL) {
+        if (update->type == Object && update->obj_type == setting->obj_type) {
+            return 1;
+        }
+        json_free(setting->obj_type);
+    }
+
+    if (update->type == String) {
+        size_t len = strlen(update->string_type);
+
+        if (setting->type != String || setting->string_cap <= len) {
+            if (setting->type == String) {
+                json_dealloc(parent->doc, setting->string_type);
+            }
+            setting->string_type = json_malloc(parent->doc, len + 1);
+            json_set_string_cap(setting, len + 1);
+        }
+
+        memmove(setting->string_type, update->string_type, len + 1);
+        setting->type = String;
+        return 1;
+    }
+
+    if (setting->type == String) {
+        json_dealloc(parent->doc, setting->string_type);
+    }
+
+    setting->type = update->type;
+
+    switch (update->type) {
+        case Boolean: setting->bool_type = update->bool_type; break;
+        case Integer: setting->long_type = update->long_type; break;
+        case Floating: setting->double_type = update->double_type; break;
+        case Object: setting->obj_type = update->obj_type; break;
+        case String: break;
+    }
+
+    return 1;
+}
+
+/**
+ * Sets a setting at the desired key, in place (see json_update_setting)
+ * @param obj Object in which set the setting
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param update Type and value to set, a String value is copied and an Object value is owned on success
+ * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ */
+int json_put_setting(json_obj_t* obj, const char* key, char separator, const json_setting_t* update) {
+    json_obj_t* parent;
+    const char* last;
+    size_t last_len;
+    json_setting_t* setting = json_walk_path(obj, key, separator, &parent, &last, &last_len);
+
+    if (parent == NULL || parent->frozen != NULL) {
+        return 0;
+    }
+
+    json_modify_path(obj, key, separator);
+    setting = json_walk_path(obj, key, separator, &parent, &last, &last_len);
+
+    return json_update_setting(parent, setting, last, last_len, update);
+}
+
+/**
+ * Sets a string setting at the desired key
+ * @param obj Object in which set the setting
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting
+ * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ */
+int json_set_string(json_obj_t* obj, const char* key, char separator, const char* value) {
+    json_setting_t update = { .type = String, .string_type = (char*)value };
+
+    return json_put_setting(obj, key, separator, &update);
+}
+
+/**
+ * Sets a boolean setting at the desired key
+ * @param obj Object in which set the setting
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting
+ * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ */
+int json_set_bool(json_obj_t* obj, const char* key, char separator, int value) {
+    json_setting_t update = { .type = Boolean, .bool_type = value };
+
+    return json_put_setting(obj, key, separator, &update);
+}
+
+/**
+ * Sets a integer setting at the desired key
+ * @param obj Object in which set the setting
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting
+ * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ */
+int json_set_integer(json_obj_t* obj, const char* key, char separator, long long value) {
+    json_setting_t update = { .type = Integer, .long_type = value };
+
+    return json_put_setting(obj, key, separator, &update);
+}
+
+/**
+ * Sets a floating setting at the desired key
+ * @param obj Object in which set the setting
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting
+ * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ */
+int json_set_floating(json_obj_t* obj, const char* key, char separator, long double value) {
+    json_setting_t update = { .type = Floating, .double_type = value };
+
+    return json_put_setting(obj, key, separator, &update);
+}
+
+/**
+ * Sets an object setting at the desired key
+ * @param obj Object in which set the setting
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting, owned by obj on success
+ * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ */
+int json_set_object(json_obj_t* obj, const char* key, char separator, json_obj_t* value) {
+    json_setting_t update = { .type = Object, .obj_type = value };
+
+    return json_put_setting(obj, key, separator, &update);
+}
+
+/**
+ * Copies the objects on a key path and applies an update to the copy of the last one (path copying).
+ * Every object that is not on the path is shared with the original.
+ * @param obj Object to copy
+ * @param key Key path (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param update Type and value to set, NULL to remove the setting
+ * @param doc Document of the copies
+ * @return The copy of obj, or NULL if the path doesn't exist
+ */
+json_obj_t* json_path_copy(json_obj_t* obj, const char* key, char separator, const json_setting_t* update, json_doc_t* doc) {
+    const char* end = strchr(key, separator);
+    size_t len = end != NULL ? (size_t)(end - key) : strlen(key);
+
+    if (len == 0) {
+        return NULL;
+    }
+
+    json_setting_t* found = json_obj_find(obj, key, len);
+    json_obj_t* child = NULL;
+
+    if (end != NULL) {
+        if (found == NULL || found->type != Object || found->obj_type == NULL) {
+            return NULL;
+        }
+
+        child = json_path_copy(found->obj_type, end + 1, separator, update, doc);
+        if (child == NULL) {
+            return NULL;
+        }
+    } else if (update == NULL && found == NULL) {
+        return NULL;
+    }
+
+    json_obj_t* copy = json_copy_node(obj, doc);
+    json_setting_t* setting = found != NULL ? copy->settings[json_obj_index(obj, found)] : NULL;
+
+    if (child != NULL) {
+        json_free(setting->obj_type);
+        setting->obj_type = child;
+    } else if (update == NULL) {
+        json_free_setting(copy->doc, json_obj_remove_at(copy, json_obj_index(copy, setting)));
+    } else {
+        json_update_setting(copy, setting, key, len, update);
+    }
+
+    copy->hash_generation = 0;
+    copy->hash128_generation = 0;
+    return copy;
+}
+
+/**
+ * Creates a new version of an object with a setting set, without modifying the original: only the objects
+ * on the key path are copied, into a document of their own, every other object is shared between both
+ * versions. Modifying a version in place from its root (json_set_*, json_remove_setting, json_merge_patch)
+ * copies the shared objects on the way first, but the original must not be modified while other threads
+ * read a version sharing objects with it.
+ * @param obj Original object
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param update Type and value to set
+ * @return The new version, to free with json_free, or NULL on failure
+ */
+json_obj_t* json_with_setting(json_obj_t* obj, const char* key, char separator, const json_setting_t* update) {
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    json_doc_t* doc = json_doc_new(NULL, &obj->doc->allocator);
+
+    if (doc == NULL) {
+        return NULL;
+    }
+
+    json_obj_t* copy = json_path_copy(obj, key, separator, update, doc);
+
+    json_doc_release(doc);
+    return copy;
+}
+
+/**
+ * Creates a new version of an object with a string setting set (see json_with_setting)
+ * @param obj Original object
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting
+ * @return The new version, or NULL on failure
+ */
+json_obj_t* json_with_string(json_obj_t* obj, const char* key, char separator, const char* value) {
+    json_setting_t update = { .type = String, .string_type = (char*)value };
+
+    return json_with_setting(obj, key, separator, &update);
+}
+
+/**
+ * Creates a new version of an object with a boolean setting set (see json_with_setting)
+ * @param obj Original object
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting
+ * @return The new version, or NULL on failure
+ */
+json_obj_t* json_with_bool(json_obj_t* obj, const char* key, char separator, int value) {
+    json_setting_t update = { .type = Boolean, .bool_type = value };
+
+    return json_with_setting(obj, key, separator, &update);
+}
+
+/**
+ * Creates a new version of an object with an integer setting set (see json_with_setting)
+ * @param obj Original object
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting
+ * @return The new version, or NULL on failure
+ */
+json_obj_t* json_with_integer(json_obj_t* obj, const char* key, char separator, long long value) {
+    json_setting_t update = { .type = Integer, .long_type = value };
+
+    return json_with_setting(obj, key, separator, &update);
+}
+
+/**
+ * Creates a new version of an object with a floating setting set (see json_with_setting)
+ * @param obj Original object
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting
+ * @return The new version, or NULL on failure
+ */
+json_obj_t* json_with_floating(json_obj_t* obj, const char* key, char separator, long double value) {
+    json_setting_t update = { .type = Floating, .double_type = value };
+
+    return json_with_setting(obj, key, separator, &update);
+}
+
+/**
+ * Creates a new version of an object with an object setting set (see json_with_setting)
+ * @param obj Original object
+ * @param key Key path at which set the setting (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @param value Value to set in the setting, owned by the new version on success
+ * @return The new version, or NULL on failure
+ */
+json_obj_t* json_with_object(json_obj_t* obj, const char* key, char separator, json_obj_t* value) {
+    json_setting_t update = { .type = Object, .obj_type = value };
+
+    return json_with_setting(obj, key, separator, &update);
+}
+
+/**
+ * Creates a new version of an object with a setting removed (see json_with_setting)
+ * @param obj Original object
+ * @param key Key path of the setting to remove (ex: object.object.setting)
+ * @param separator Separator of keys in key path
+ * @return The new version, or NULL if the setting doesn't exist
+ */
+json_obj_t* json_without(json_obj_t* obj, const char* key, char separator) {
+    return json_with_setting(obj, key, separator, NULL);
+}
+
+/**
+ * Deep copies an object into a document (see json_clone)
+ * @param obj Object to copy
+ * @param doc Document of the copy
+ * @return The copy
+ */
+json_obj_t* json_clone_node(json_obj_t* obj, json_doc_t* doc) {
+    json_obj_t* copy = json_copy_node(obj, doc);
+
+    for (size_t i = 0; i < copy->settings_count; i++) {
+        json_setting_t* setting = copy->settings[i];
+
+        if (setting->type == Object && setting->obj_type != NULL) {
+            json_obj_t* shared = setting->obj_type;
+
+            setting->obj_type = json_clone_node(shared, doc);
+            json_free(shared);
+        }
+    }
+
+    return copy;
+}
+
+/**
+ * Deep copies an object, without going through serialization. The copy is never frozen and shares nothing
+ * with the original, not even its document.
+ * @param obj Object to copy
+ * @return The copy, or NULL if obj is NULL
+ */
+json_obj_t* json_clone(json_obj_t* obj) {
+    if (obj == NULL) {
+        return NULL;
+    }
+
+    json_doc_t* doc = json_doc_new(NULL, &obj->doc->allocator);
+
+    if (doc == NULL) {
+        return NULL;
+    }
+
+    json_obj_t* copy = json_clone_node(obj, doc);
+
+    json_doc_release(doc);
+    return copy;
+}
+
+/**
+ * Checks that a merge patch can be applied: objects of the target it modifies and objects of the patch it
+ * moves must not be frozen
+ * @param target Object to patch, NULL when the patch subtree is moved as a whole
+ * @param patch Patch object
+ * @return 0 if the patch can't be applied, 1 otherwise
+ */
+int json_merge_patch_check(json_obj_t* target, json_obj_t* patch) {
+    if (patch->frozen != NULL || (target != NULL && target->frozen != NULL && patch->settings_count != 0)) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < patch->settings_count; i++) {
+        json_setting_t* p = patch->settings[i];
+
+        if (p->type != Object || p->obj_type == NULL) {
+            continue;
+        }
+
+        json_setting_t* t = target != NULL ? json_obj_find(target, p->name, strlen(p->name)) : NULL;
+        json_obj_t* sub_target = t != NULL && t->type == Object ? t->obj_type : NULL;
+
+        if (json_merge_patch_check(sub_target, p->obj_type) == 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * Removes the null settings of a patch subtree that is moved as a whole into the target. Objects shared with
+ * other versions are copied first (see json_unshare), the versions keep their null settings.
+ * @param obj Patch subtree, only referenced by the patch
+ */
+void json_merge_patch_strip(json_obj_t* obj) {
+    json_invalidate_hash(obj, 0);
+
+    for (size_t i = 0; i < obj->settings_count;) {
+        json_setting_t* setting = obj->settings[i];
+
+        if (setting->type == Object && setting->obj_type == NULL) {
+            json_free_setting(obj->doc, json_obj_remove_at(obj, i));
+            continue;
+        }
+        if (setting->type == Object) {
+            json_merge_patch_strip(json_unshare(obj, setting));
+        }
+        i++;
+    }
+}
+
+/**
+ * Applies a patch to a target in a single lockstep traversal of both objects (RFC 7386)
+ * @param target Object to patch
+ * @param patch Patch object, only referenced by the caller: objects moved to the target are detached from it
+ */
+void json_merge_patch_apply(json_obj_t* target, json_obj_t* patch) {
+    json_invalidate_hash(target, 0);
+
+    for (size_t i = 0; i < patch->settings_count; i++) {
+        json_setting_t* p = patch->settings[i];
+        json_setting_t* t = json_obj_find(target, p->name, strlen(p->name));
+
+        if (p->type == Object && p->obj_type == NULL) {
+            if (t != NULL) {
+                json_free_setting(target->doc, json_obj_remove_at(target, json_obj_index(target, t)));
+            }
+            continue;
+        }
+
+        if (p->type == Object && t != NULL && t->type == Object && t->obj_type != NULL) {
+            json_merge_patch_apply(json_unshare(target, t), json_unshare(patch, p));
+            continue;
+        }
+
+        if (p->type == Object) {
+            json_merge_patch_strip(json_unshare(patch, p));
+        }
+
+        /* Replaced in place or appended, strings are copied into the target's document and objects are moved */
+        if (json_update_setting(target, t, p->name, strlen(p->name), p) && p->type == Object) {
+            p->obj_type = NULL;
+        }
+    }
+}
+
+/**
+ * Applies a JSON merge patch (RFC 7386) to an object: settings of the patch are added or replaced in the
+ * target, null settings are removed from it, and objects are merged recursively. Patch subtrees are moved
+ * into the target rather than copied, so the cost follows the size of the patch.
+ * @param target Object to patch
+ * @param patch Patch object, freed by the call on success
+ * @return 0 on failure (nothing is modified and the patch isn't freed), 1 on success
+ */
+int json_merge_patch(json_obj_t* target, json_obj_t* patch) {
+    if (target == NULL || patch == NULL || json_merge_patch_check(target, patch) == 0) {
+        return 0;
+    }
+
+    json_invalidate_hash(target, 1);
+    json_merge_patch_apply(target, patch);
+    json_free(patch);
+
+    return 1;
+}
+
+/**
+ * Checks if two settings have equal values, objects are compared by structural hash
+ * @param a First setting
+ * @param b Second setting
+ * @return Boolean value
+ */
+int json_setting_equal(json_setting_t* a, json_setting_t* b) {
+    if (a->type != b->type) {
+        return 0;
+    }
+
+    switch (a->type) {
+        case Boolean: return (a->bool_type != 0) == (b->bool_type != 0);
+        case Integer: return a->long_type == b->long_type;
+        case Floating: return a->double_type == b->double_type;
+        case String: return strcmp(a->string_type, b->string_type) == 0;
+        case Object: {
+            if (a->obj_type == NULL || b->obj_type == NULL) {
+                return a->obj_type == b->obj_type;
+            }
+            return json_obj_hash(a->obj_type) == json_obj_hash(b->obj_type);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Changed paths collected by json_diff
+ */
+typedef struct json_diff_s {
+    char** paths;
+    size_t count;
+    size_t cap;
+    json_buf_t prefix;
+    char separator;
+} json_diff_t;
+
+/**
+ * Adds the path of a setting to a diff
+ * @param diff Diff to add to
+ * @param name Name of the setting, appended to the current prefix
+ */
+void json_diff_add(json_diff_t* diff, const char* name) {
+    size_t len = strlen(name);
+
+    if (diff->count + 1 >= diff->cap) {
+        diff->cap = diff->cap ? diff->cap * 2 : 8;
+        diff->paths = json_realloc(NULL, diff->paths, sizeof(char*) * diff->cap);
+    }
+
+    char* path = json_malloc(NULL, diff->prefix.len + len + 1);
+    memcpy(path, diff->prefix.data, diff->prefix.len);
+    memcpy(path + diff->prefix.len, name, len + 1);
+
+    diff->paths[diff->count++] = path;
+    diff->paths[diff->count] = NULL;
+}
+
+/**
+ * Collects the changed paths between two objects. Sub-objects with equal structural hashes are skipped.
+ * @param diff Diff to add to
+ * @param a Old object
+ * @param b New object
+ */
+void json_diff_objects(json_diff_t* diff, json_obj_t* a, json_obj_t* b) {
+    if (json_obj_hash(a) == json_obj_hash(b)) {
+        return;
+    }
+
+    for (size_t i = 0; i < a->settings_count; i++) {
+        json_setting_t* sa = a->settings[i];
+        json_setting_t* sb = json_obj_find(b, sa->name, strlen(sa->name));
+
+        if (sb == NULL) {
+            json_diff_add(diff, sa->name);
+            continue;
+        }
+
+        if (sa->type == Object && sb->type == Object && sa->obj_type != NULL && sb->obj_type != NULL) {
+            size_t len = diff->prefix.len;
+
+            json_buf_printf(&diff->prefix, "%s%c", sa->name, diff->separator);
+            json_diff_objects(diff, sa->obj_type, sb->obj_type);
+            diff->prefix.len = len;
+            continue;
+        }
+
+        if (json_setting_equal(sa, sb) == 0) {
+            json_diff_add(diff, sa->name);
+        }
+    }
+
+    for (size_t i = 0; i < b->settings_count; i++) {
+        if (json_obj_find(a, b->settings[i]->name, strlen(b->settings[i]->name)) == NULL) {
+            json_diff_add(diff, b->settings[i]->name);
+        }
+    }
+}
+
+/**
+ * Lists the paths of the settings that differ between two objects: changed, removed (present in a only) and
+ * added (present in b only) settings. A changed object is described by the paths of its changed settings.
+ * Unchanged sub-objects are skipped in constant time thanks to the structural hash cached in every object.
+ * @param a Old object
+ * @param b New object
+ * @param separator Separator of keys in the returned paths
+ * @return NULL-terminated array of paths (empty if the objects are equal) to free with json_diff_free, or NULL on error
+ */
+char** json_diff(json_obj_t* a, json_obj_t* b, char separator) {
+    if (a == NULL || b == NULL) {
+        return NULL;
+    }
+
+    json_diff_t diff = { json_calloc(NULL, 1, sizeof(char*)), 0, 1, { 0 }, separator };
+
+    json_buf_append(&diff.prefix, "", 0);
+    json_diff_objects(&diff, a, b);
+    json_free_string(diff.prefix.data);
+
+    return diff.paths;
+}
+
+/**
+ * Frees an array of paths returned by json_diff
+ * @param diff Array to free
+ */
+void json_diff_free(char** diff) {
+    if (diff != NULL) {
+        json_free_double_char_array(diff);
+    }
+}
+
+/**
+ * Selector of a query step
+ */
+enum json_query_selector_e {
+    QueryName,
+    QueryWildcard,
+    QueryFilter,
+};
+
+/**
+ * Comparison of a query filter
+ */
+enum json_query_op_e {
+    QueryExists,
+    QueryEqual,
+    QueryNotEqual,
+    QueryLess,
+    QueryLessEqual,
+    QueryGreater,
+    QueryGreaterEqual,
+};
+
+/**
+ * Step of a compiled query, selecting members of the objects reached by the previous step
+ */
+typedef struct json_query_step_s {
+    enum json_query_selector_e selector;
+    int recursive;
+    char* name;
+    size_t name_len;
+    unsigned long long hash;
+    char* filter_path;
+    enum json_query_op_e op;
+    json_setting_t literal;
+} json_query_step_t;
+
+struct json_query_s {
+    json_query_step_t* steps;
+    size_t step_count;
+};
+
+/**
+ * State of json_query_run
+ */
+typedef struct json_query_run_s {
+    const json_query_t* query;
+    int (*on_match)(json_setting_t* setting, void* ctx);
+    void* ctx;
+    size_t matches;
+    int stopped;
+} json_query_run_t;
+
+/**
+ * Frees a compiled query
+ * @param query Query to free, can be NULL
+ */
+void json_query_free(json_query_t* query) {
+    if (query == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < query->step_count; i++) {
+        json_dealloc(NULL, query->steps[i].name);
+        json_dealloc(NULL, query->steps[i].filter_path);
+
+        if (query->steps[i].literal.type == String) {
+            json_dealloc(NULL, query->steps[i].literal.string_type);
+        }
+    }
+
+    json_dealloc(NULL, query->steps);
+    json_dealloc(NULL, query);
+}
+
+/**
+ * Copies part of a string into a new NUL-terminated string
+ * @param str String to copy from
+ * @param len Number of bytes to copy
+ * @return The copy, to free with json_dealloc(NULL, ...)
+ */
+char* json_query_strndup(const char* str, size_t len) {
+    char* copy = json_malloc(NULL, len + 1);
+
+    memcpy(copy, str, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/**
+ * Parses the literal of a query filter: a quoted string, a number, true, false or null
+ * @param str Literal
+ * @param literal Filled with the type and value of the literal
+ * @return Number of characters read, 0 if the literal is invalid
+ */
+size_t json_query_parse_literal(const char* str, json_setting_t* literal) {
+    if (str[0] == '\'' || str[0] == '\"') {
+        const char* end = strchr(str + 1, str[0]);
+
+        if (end == NULL) {
+            return 0;
+        }
+
+        literal->type = String;
+        literal->string_type = json_query_strndup(str + 1, end - str - 1);
+        return end - str + 1;
+    }
+
+    if (strncmp(str, "true", 4) == 0 || strncmp(str, "false", 5) == 0) {
+        literal->type = Boolean;
+        literal->bool_type = str[0] == 't';
+        return str[0] == 't' ? 4 : 5;
+    }
+
+    if (strncmp(str, "null", 4) == 0) {
+        literal->type = Object;
+        literal->obj_type = NULL;
+        return 4;
+    }
+
+    char* end;
+    size_t len = strspn(str, "+-0123456789.eE");
+
+    if (len == 0) {
+        return 0;
+    }
+
+    if (memchr(str, '.', len) != NULL || memchr(str, 'e', len) != NULL || memchr(str, 'E', len) != NULL) {
+        literal->type = Floating;
+        literal->double_type = strtold(str, &end);
+    } else {
+        literal->type = Integer;
+        literal->long_type = strtoll(str, &end, 10);
+    }
+
+    return end == str + len ? len : 0;
+}
+
+/**
+ * Parses a query filter, after its "[?("
+ * @param str Filter (ex: "@.port > 80)]")
+ * @param step Step to fill
+ * @return Number of characters read including the closing ")]", 0 if the filter is invalid
+ */
+size_t json_query_parse_filter(const char* str, json_query_step_t* step) {
+    static const struct { const char* text; enum json_query_op_e op; } ops[] = {
+        { "==", QueryEqual }, { "!=", QueryNotEqual }, { "<=", QueryLessEqual },
+        { ">=", QueryGreaterEqual }, { "<", QueryLess }, { ">", QueryGreater },
+    };
+    size_t i = strspn(str, " ");
+
+    if (str[i] != '@') {
+        return 0;
+    }
+    i++;
+
+    /* "@" alone is the member itself, "@.a.b" a setting of the member */
+    size_t path_len = str[i] == '.' ? strcspn(str + i + 1, " =!<>)") : 0;
+
+    if (str[i] == '.' && path_len == 0) {
+        return 0;
+    }
+
+    step->filter_path = json_query_strndup(str + i + 1, path_len);
+    i += path_len + (str[i] == '.');
+    i += strspn(str + i, " ");
+
+    step->op = QueryExists;
+    for (size_t j = 0; j < sizeof(ops) / sizeof(ops[0]); j++) {
+        size_t len = strlen(ops[j].text);
+
+        if (strncmp(str + i, ops[j].text, len) == 0) {
+            step->op = ops[j].op;
+            i += len;
+            break;
+        }
+    }
+
+    if (step->op != QueryExists) {
+        i += strspn(str + i, " ");
+
+        size_t len = json_query_parse_literal(str + i, &step->literal);
+
+        if (len == 0) {
+            return 0;
+        }
+        i += len + strspn(str + i + len, " ");
+    }
+
+    return str[i] == ')' && str[i + 1] == ']' ? i + 2 : 0;
+}
+
+/**
+ * Compiles a query into a plan that can be run on any number of objects. The syntax follows JSONPath:
+ * "$" is the root (optional), ".name" or "['name']" selects a member, ".*" or "[*]" every member,
+ * ".." selects at any depth, and "[?(@.key op literal)]" selects the members (of the current objects)
+ * for which the comparison holds, op being one of == != < <= > >= (or none to test that the key exists).
+ * @param query Query (ex: "$.services.*.timeout_ms", "$..port", "$.services[?(@.port >= 8000)].name")
+ * @return The compiled query, to free with json_query_free, or NULL if the query is invalid
+ */
+json_query_t* json_query_compile(const char* query) {
+    json_query_t* compiled = json_calloc(NULL, 1, sizeof(json_query_t));
+    size_t cap = 0;
+    size_t i = query[0] == '$';
+
+    while (query[i] != '\0') {
+        if (compiled->step_count == cap) {
+            cap = cap ? cap * 2 : 4;
+            compiled->steps = json_realloc(NULL, compiled->steps, sizeof(json_query_step_t) * cap);
+        }
+
+        json_query_step_t* step = &compiled->steps[compiled->step_count++];
+        size_t len = 0;
+
+        memset(step, 0, sizeof(json_query_step_t));
+        step->literal.type = Boolean;
+
+        if (query[i] == '.') {
+            step->recursive = query[i + 1] == '.';
+            i += step->recursive ? 2 : 1;
+
+            if (query[i] == '*') {
+                step->selector = QueryWildcard;
+                len = 1;
+            } else if (query[i] != '[') {
+                len = strcspn(query + i, ".[");
+                step->selector = QueryName;
+                step->name = json_query_strndup(query + i, len);
+                step->name_len = len;
+            }
+            i += len;
+
+            if (len != 0) {
+                continue;
+            }
+            if (query[i] != '[' || !step->recursive) {
+                json_query_free(compiled);
+                return NULL;
+            }
+        }
+
+        if (query[i] != '[') {
+            json_query_free(compiled);
+            return NULL;
+        }
+
+        if (strncmp(query + i, "[*]", 3) == 0) {
+            step->selector = QueryWildcard;
+            len = 3;
+        } else if (strncmp(query + i, "[?(", 3) == 0) {
+            step->selector = QueryFilter;
+            len = json_query_parse_filter(query + i + 3, step);
+            len += len != 0 ? 3 : 0;
+        } else if (query[i + 1] == '\'' || query[i + 1] == '\"') {
+            const char* end = strchr(query + i + 2, query[i + 1]);
+
+            if (end != NULL && end[1] == ']') {
+                step->selector = QueryName;
+                step->name_len = end - (query + i + 2);
+                step->name = json_query_strndup(query + i + 2, step->name_len);
+                len = end + 2 - (query + i);
+            }
+        }
+
+        if (len == 0) {
+            json_query_free(compiled);
+            return NULL;
+        }
+        i += len;
+    }
+
+    for (size_t s = 0; s < compiled->step_count; s++) {
+        if (compiled->steps[s].selector == QueryName) {
+            compiled->steps[s].hash = json_hash_bytes(compiled->steps[s].name, compiled->steps[s].name_len);
+        }
+    }
+
+    if (compiled->step_count == 0) {
+        json_query_free(compiled);
+        return NULL;
+    }
+
+    return compiled;
+}
+
+/**
+ * Compares a setting to the literal of a filter
+ * @param setting Setting to compare
+ * @param step Step holding the filter
+ * @return Boolean value
+ */
+int json_query_compare(json_setting_t* setting, const json_query_step_t* step) {
+    const json_setting_t* literal = &step->literal;
+    int cmp;
+
+    if (step->op == QueryExists) {
+        return setting != NULL;
+    }
+    if (setting == NULL) {
+        return 0;
+    }
+
+    int numbers = (setting->type == Integer || setting->type == Floating)
+        && (literal->type == Integer || literal->type == Floating);
+
+    if (numbers) {
+        long double a = setting->type == Integer ? (long double)setting->long_type : setting->double_type;
+        long double b = literal->type == Integer ? (long double)literal->long_type : literal->double_type;
+
+        cmp = a < b ? -1 : a > b;
+    } else if (setting->type != literal->type) {
+        return step->op == QueryNotEqual;
+    } else if (setting->type == String) {
+        cmp = strcmp(setting->string_type, literal->string_type);
+    } else if (setting->type == Boolean) {
+        cmp = (setting->bool_type != 0) != (literal->bool_type != 0);
+    } else {
+        /* Objects only compare to null */
+        cmp = setting->obj_type != NULL;
     }
 
-    char* file_content = json_get_file_content(fd);
-    json_obj_t* obj = json_from_string(file_content);
+    switch (step->op) {
+        case QueryEqual: return cmp == 0;
+        case QueryNotEqual: return cmp != 0;
+        case QueryLess: return cmp < 0;
+        case QueryLessEqual: return cmp <= 0;
+        case QueryGreater: return cmp > 0;
+        case QueryGreaterEqual: return cmp >= 0;
+        case QueryExists: break;
+    }
 
-    free(file_content);
-    close(fd);
-    return obj;
+    return 0;
 }
 
 /**
- * Concatenates two strings together
- * @param dest String to concat with
- * @param src String to concat on top of dest
- * @return Concatenated string
+ * Checks if a member of an object is selected by a query step
+ * @param setting Member
+ * @param step Step
+ * @param name Interned name of the step in the document of the object, NULL if absent from it
+ * @return Boolean value
  */
-char* json_strcat(char* dest, const char* src) {
-    const size_t a = strlen(dest);
-    const size_t b = strlen(src);
-    const size_t size_ab = a + b + 1;
+int json_query_selects(json_setting_t* setting, const json_query_step_t* step, const char* name) {
+    switch (step->selector) {
+        case QueryName: return setting->name == name;
+        case QueryWildcard: return 1;
+        case QueryFilter: {
+            if (step->filter_path[0] == '\0') {
+                return json_query_compare(setting, step);
+            }
+            if (setting->type != Object || setting->obj_type == NULL) {
+                return 0;
+            }
 
-    dest = realloc(dest, size_ab + 1);
+            json_obj_t* parent;
+            const char* last;
+            size_t last_len;
 
-    memcpy(dest + a, src, b + 1);
+            return json_query_compare(json_walk_path(setting->obj_type, step->filter_path, '.', &parent, &last, &last_len), step);
+        }
+    }
 
-    return dest;
+    return 0;
 }
 
 /**
- * Returns a formatted (Indented... etc.) JSON string from an un-formatted one
- * @param dump Un-formatted JSON string
- * @return Formatted JSON string
+ * Applies a query step to an object, then the next steps to the selected members
+ * @param run State of the run
+ * @param index Index of the step
+ * @param obj Object to apply the step to
  */
-char* json_format(const char* str) {
-    char* ret = NULL;
+void json_query_apply(json_query_run_t* run, size_t index, json_obj_t* obj) {
+    const json_query_step_t* step = &run->query->steps[index];
+    int last = index + 1 == run->query->step_count;
+    const char* name = NULL;
 
-    int quotes = 0;
-    int braces = 0;
-    int count = 0;
-    for (int i = 0; str[i] != '\0'; i++) {
-        if (str[i] == '\"' && (i == 0 ? 1 : str[i - 1] != '\\')) {
-            if (!(quotes % 2)) {
-                for (int k = 0; k < braces; k++) {
-                    count++;
-                }
-            }
-            count++;
-            quotes++;
-            continue;
+    /* A plain name step is a single lookup, the object's members don't need to be scanned */
+    if (step->selector == QueryName && !step->recursive) {
+        json_setting_t* setting = json_obj_find(obj, step->name, step->name_len);
+
+        if (setting == NULL) {
+            return;
         }
-        if (str[i] == '{' && !(quotes % 2)) {
-            braces++;
-            count += 2;
-            continue;
+        if (last) {
+            run->matches++;
+            run->stopped = run->on_match(setting, run->ctx) != 0;
+        } else if (setting->type == Object && setting->obj_type != NULL) {
+            json_query_apply(run, index + 1, setting->obj_type);
         }
-        if (str[i] == '}' && !(quotes % 2)) {
-            braces--;
-            count += 2;
-            for (int k = 0; k < braces; k++) {
-                count++;
+        return;
+    }
+
+    if (step->selector == QueryName) {
+        name = json_intern_find(obj->doc, step->name, step->name_len, step->hash);
+    }
+
+    for (size_t i = 0; i < obj->settings_count && !run->stopped; i++) {
+        json_setting_t* setting = obj->settings[i];
+        int object = setting->type == Object && setting->obj_type != NULL;
+
+        if (json_query_selects(setting, step, name)) {
+            if (last) {
+                run->matches++;
+                run->stopped = run->on_match(setting, run->ctx) != 0;
+            } else if (object) {
+                json_query_apply(run, index + 1, setting->obj_type);
             }
         }
-        if (str[i] == ':' && !(quotes % 2)) {
-            count += 2;
-            continue;
+
+        if (step->recursive && object && !run->stopped) {
+            json_query_apply(run, index, setting->obj_type);
         }
-        if (str[i] == ',' && !(quotes % 2)) {
-            count += 2;
-            continue;
+    }
+}
+
+/**
+ * Runs a compiled query on an object, streaming the selected settings to a callback as they are found.
+ * Nothing is allocated during the run.
+ * @param query Compiled query (see json_query_compile)
+ * @param obj Object to query
+ * @param on_match Called with each selected setting, returning nonzero stops the run
+ * @param ctx Context passed to on_match
+ * @return Number of selected settings passed to on_match
+ */
+size_t json_query_run(const json_query_t* query, json_obj_t* obj, int (*on_match)(json_setting_t* setting, void* ctx), void* ctx) {
+    json_query_run_t run = { query, on_match, ctx, 0, 0 };
+
+    if (query != NULL && obj != NULL && on_match != NULL) {
+        json_query_apply(&run, 0, obj);
+    }
+
+    return run.matches;
+}
+
+/**
+ * Stores an integer in a field of the given size
+ * @param field Pointer to the field
+ * @param size Size of the field in bytes
+ * @param value Value to store
+ * @return 0 if the size isn't the one of an integer type, 1 on success
+ */
+int json_bind_store_integer(void* field, size_t size, long long value) {
+    switch (size) {
+        case sizeof(char): *(char*)field = (char)value; return 1;
+        case sizeof(short): *(short*)field = (short)value; return 1;
+        case sizeof(int): *(int*)field = (int)value; return 1;
+        case sizeof(long long): *(long long*)field = value; return 1;
+        default: return 0;
+    }
+}
+
+/**
+ * Loads an integer from a field of the given size
+ * @param field Pointer to the field
+ * @param size Size of the field in bytes
+ * @param value Receives the value of the field
+ * @return 0 if the size isn't the one of an integer type, 1 on success
+ */
+int json_bind_load_integer(const void* field, size_t size, long long* value) {
+    switch (size) {
+        case sizeof(char): *value = *(const char*)field; return 1;
+        case sizeof(short): *value = *(const short*)field; return 1;
+        case sizeof(int): *value = *(const int*)field; return 1;
+        case sizeof(long long): *value = *(const long long*)field; return 1;
+        default: return 0;
+    }
+}
+
+/**
+ * Stores the value of a setting in the field of a binding
+ * @param setting Setting to store
+ * @param binding Binding of the field
+ * @param dest Structure holding the field
+ * @return 0 if the setting isn't of the bound type or the field size isn't supported, 1 on success
+ */
+int json_bind_field(const json_setting_t* setting, const json_binding_t* binding, void* dest) {
+    char* field = (char*)dest + binding->offset;
+    size_t size = binding->size;
+
+    switch (binding->type) {
+        case Boolean: {
+            return setting->type == Boolean && json_bind_store_integer(field, size, setting->bool_type);
         }
-        if (json_is_invisible(str[i]) && !(quotes % 2)) {
-            continue;
+        case Integer: {
+            return setting->type == Integer && json_bind_store_integer(field, size, setting->long_type);
         }
-        count++;
-    }
+        case Floating: {
+            if (setting->type != Floating && setting->type != Integer) {
+                return 0;
+            }
 
-    ret = malloc(strlen(str) + count + 1);
+            long double value = setting->type == Floating ? setting->double_type : (long double)setting->long_type;
 
-    int j = 0;
-    quotes = 0;
-    braces = 0;
-    for (int i = 0; str[i] != '\0'; i++) {
-        if (str[i] == '\"' && (i == 0 ? 1 : str[i - 1] != '\\')) {
-            if (!(quotes % 2) && str[i - 1] != ':') {
-                for (int k = 0; k < braces; k++) {
-                    ret[j] = '\t'; j++;
-                }
+            if (size == sizeof(float)) {
+                *(float*)field = (float)value;
+            } else if (size == sizeof(double)) {
+                *(double*)field = (double)value;
+            } else if (size == sizeof(long double)) {
+                *(long double*)field = value;
+            } else {
+                return 0;
             }
-            ret[j] = '\"'; j++;
-            quotes++;
-            continue;
+            return 1;
         }
-        if (str[i] == '{' && !(quotes % 2)) {
-            braces++;
-            ret[j] = '{'; j++;
-            if (str[i+1] != '}') {
-                ret[j] = '\n'; j++;
+        case String: {
+            if (setting->type != String || size == 0) {
+                return 0;
             }
-            continue;
+
+            size_t len = strlen(setting->string_type);
+            len = len < size - 1 ? len : size - 1;
+            memcpy(field, setting->string_type, len);
+            field[len] = '\0';
+            return 1;
         }
-        if (str[i] == '}' && !(quotes % 2)) {
-            braces--;
-            if (str[i-1] != '{') {
-                ret[j] = '\n'; j++;
-                for (int k = 0; k < braces; k++) {
-                    ret[j] = '\t'; j++;
-                }
+        case Object: {
+            if (setting->type != Object || size != sizeof(json_obj_t*)) {
+                return 0;
             }
-            ret[j] = '}'; j++;
-            continue;
+
+            *(json_obj_t**)field = setting->obj_type;
+            return 1;
         }
-        if (str[i] == ':' && !(quotes % 2)) {
-            ret[j] = ':'; j++;
-            ret[j] = ' '; j++;
-            continue;
+    }
+
+    return 0;
+}
+
+/**
+ * Populates a structure from an object, following a table of bindings (see JSON_BINDING).
+ * Fields whose setting doesn't exist or isn't of the bound type are left untouched.
+ * Boolean and Integer bindings accept any integer field size, Floating bindings accept float, double and
+ * long double fields (and integer settings), String bindings copy into char arrays (truncated if needed),
+ * Object bindings store a json_obj_t* borrowed from obj.
+ * @param obj Object to read from
+ * @param bindings Table of bindings
+ * @param count Number of bindings in the table
+ * @param separator Separator of keys in the binding paths
+ * @param dest Structure to populate
+ * @return Number of populated fields
+ */
+size_t json_bind(json_obj_t* obj, const json_binding_t* bindings, size_t count, char separator, void* dest) {
+    size_t bound = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        json_setting_t* setting = json_lookup(obj, bindings[i].path, separator);
+
+        if (setting != NULL) {
+            bound += json_bind_field(setting, &bindings[i], dest);
         }
-        if (str[i] == ',' && !(quotes % 2)) {
-            ret[j] = ','; j++;
-            ret[j] = '\n'; j++;
-            continue;
+    }
+
+    return bound;
+}
+
+size_t json_skip_string(const char* text, size_t len, size_t pos);
+size_t json_skip_value(const char* text, size_t len, size_t pos);
+size_t json_skip_invisible(const char* text, size_t len, size_t pos);
+int json_raw_key_equal(const char* raw, size_t raw_len, const char* key, size_t key_len);
+int json_extract_value(const char* text, size_t len, json_extract_t* out);
+
+/**
+ * Populates a field from a raw value of JSON text (see json_bind_string)
+ * @param text Value
+ * @param len Length of the value
+ * @param binding Binding of the field
+ * @param dest Structure to populate
+ * @return 1 if the field was populated, 0 otherwise
+ */
+int json_bind_raw(const char* text, size_t len, const json_binding_t* binding, void* dest) {
+    json_extract_t value;
+    int bound = 0;
+
+    if (json_extract_value(text, len, &value) == 0) {
+        return 0;
+    }
+
+    json_setting_t setting = { .type = value.type };
+
+    switch (value.type) {
+        case Boolean: setting.bool_type = value.bool_type; break;
+        case Integer: setting.long_type = value.long_type; break;
+        case Floating: setting.double_type = value.double_type; break;
+        case String: setting.string_type = json_unescape(NULL, value.text, value.len); break;
+        case Object: setting.obj_type = NULL; break;
+    }
+
+    if (value.type != String || setting.string_type != NULL) {
+        bound = json_bind_field(&setting, binding, dest);
+    }
+    if (value.type == String) {
+        json_dealloc(NULL, setting.string_type);
+    }
+
+    return bound;
+}
+
+/**
+ * Populates the fields bound under an object of JSON text, in a single scan of its members (see
+ * json_bind_string). Each member is matched against the bindings whose path continues with its key: the
+ * fields of the paths ending there are populated, and the object is descended into once for the others.
+ * Only the first occurrence of a duplicated key is used, like json_extract.
+ * @param text JSON text
+ * @param len Length of the text, up to the end of the object
+ * @param pos Index of the opening bracket of the object
+ * @param prefix Key path of the object followed by the separator, as written in the bindings
+ * @param prefix_len Length of the prefix, 0 for the top-level object
+ * @param bindings Table of bindings
+ * @param count Number of bindings in the table
+ * @param separator Separator of keys in the binding paths
+ * @param dest Structure to populate
+ * @param done Bindings already matched, filled by the function
+ * @return Number of populated fields
+ */
+size_t json_bind_members(const char* text, size_t len, size_t pos, const char* prefix, size_t prefix_len,
+                         const json_binding_t* bindings, size_t count, char separator, void* dest, char* done) {
+    size_t bound = 0;
+
+    pos = json_skip_invisible(text, len, pos + 1);
+
+    while (pos < len && text[pos] == '\"') {
+        size_t name_end = json_skip_string(text, len, pos);
+
+        if (name_end == SIZE_MAX) {
+            break;
         }
-        if (json_is_invisible(str[i]) && !(quotes % 2)) {
-            continue;
+
+        const char* name = text + pos + 1;
+        size_t name_len = name_end - pos - 2;
+
+        pos = json_skip_invisible(text, len, name_end);
+        if (pos >= len || text[pos] != ':') {
+            break;
+        }
+
+        pos = json_skip_invisible(text, len, pos + 1);
+        size_t value_end = json_skip_value(text, len, pos);
+
+        if (value_end == SIZE_MAX) {
+            break;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            const char* path = bindings[i].path;
+
+            if (done[i] || strncmp(path, prefix, prefix_len) != 0) {
+                continue;
+            }
+
+            const char* key = path + prefix_len;
+            const char* end = strchr(key, separator);
+            size_t key_len = end != NULL ? (size_t)(end - key) : strlen(key);
+
+            if (json_raw_key_equal(name, name_len, key, key_len) == 0) {
+                continue;
+            }
+
+            if (end == NULL) {
+                done[i] = 1;
+                bound += json_bind_raw(text + pos, value_end - pos, &bindings[i], dest);
+                continue;
+            }
+
+            /* Every binding under this member is handled by a single descent */
+            size_t sub_len = end - path + 1;
+
+            if (text[pos] == '{') {
+                bound += json_bind_members(text, value_end, pos, path, sub_len, bindings, count, separator, dest, done);
+            }
+            for (size_t j = i; j < count; j++) {
+                done[j] |= strncmp(bindings[j].path, path, sub_len) == 0;
+            }
+        }
+
+        pos = json_skip_invisible(text, len, value_end);
+        if (pos >= len || text[pos] != ',') {
+            break;
         }
-        ret[j] = str[i]; j++;
+        pos = json_skip_invisible(text, len, pos + 1);
     }
-    ret[j] = '\0';
 
-    return ret;
+    return bound;
 }
 
 /**
- * Creates a human readable string containing the given JSON object
- * @param obj JSON object to dump
- * @return JSON string
+ * Populates a structure straight from a serialized JSON string, following a table of bindings (see json_bind).
+ * No object is built: the members of the text are scanned once, values that no binding needs are skipped
+ * by balancing their quotes and brackets, so errors in them aren't detected. String fields are decoded and
+ * copied, Object bindings are skipped since there is no object to point to.
+ * @param str JSON string
+ * @param bindings Table of bindings
+ * @param count Number of bindings in the table
+ * @param separator Separator of keys in the binding paths
+ * @param dest Structure to populate
+ * @return Number of populated fields
  */
-char* json_dump(json_obj_t* obj, int format) {
-    char* tmp;
-    char* str = malloc(2);
-    strncpy(str, "{", 2);
+size_t json_bind_string(const char* str, const json_binding_t* bindings, size_t count, char separator, void* dest) {
+    size_t len = strlen(str);
+    size_t pos = json_skip_invisible(str, len, 0);
 
-    for (size_t i = 0; i < obj->settings_count; i++) {
-        size_t needed = snprintf(NULL, 0, "\"%s\":", obj->settings[i]->name) + 1;
-        tmp = malloc(needed);
-        sprintf(tmp, "\"%s\":", obj->settings[i]->name);
-        str = json_strcat(str, tmp);
-        free(tmp);
+    if (count == 0 || pos >= len || str[pos] != '{') {
+        return 0;
+    }
+
+    char* done = json_calloc(NULL, count, 1);
+
+    for (size_t i = 0; i < count; i++) {
+        done[i] = bindings[i].type == Object;
+    }
+
+    size_t bound = json_bind_members(str, len, pos, "", 0, bindings, count, separator, dest, done);
+
+    json_dealloc(NULL, done);
+    return bound;
+}
 
-        switch (obj->settings[i]->type) {
+/**
+ * Writes the fields of a structure back into an object, following a table of bindings (see json_bind).
+ * Like the setters, a field whose parent object doesn't exist isn't written. Object bindings are skipped,
+ * the structure doesn't own the objects it points to. Fields of a size json_bind rejects aren't written either.
+ * @param obj Object to write to
+ * @param bindings Table of bindings
+ * @param count Number of bindings in the table
+ * @param separator Separator of keys in the binding paths
+ * @param src Structure to read from
+ * @return Number of written settings
+ */
+size_t json_unbind(json_obj_t* obj, const json_binding_t* bindings, size_t count, char separator, const void* src) {
+    size_t written = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const char* field = (const char*)src + bindings[i].offset;
+        size_t size = bindings[i].size;
+
+        switch (bindings[i].type) {
             case Boolean: {
-                needed = snprintf(NULL, 0, "%s%s", obj->settings[i]->bool_type ? "true" : "false", i == obj->settings_count - 1 ? "" : ",") + 1;
-                tmp = malloc(needed);
-                sprintf(tmp, "%s%s", obj->settings[i]->bool_type ? "true" : "false", i == obj->settings_count - 1 ? "" : ",");
-                str = json_strcat(str, tmp);
-                free(tmp);
+                long long value;
+
+                if (json_bind_load_integer(field, size, &value)) {
+                    written += json_set_bool(obj, bindings[i].path, separator, value != 0);
+                }
                 break;
             }
             case Integer: {
-                needed = snprintf(NULL, 0, "%lld%s", obj->settings[i]->long_type, i == obj->settings_count - 1 ? "" : ",") + 1;
-                tmp = malloc(needed);
-                sprintf(tmp, "%lld%s", obj->settings[i]->long_type, i == obj->settings_count - 1 ? "" : ",");
-                str = json_strcat(str, tmp);
-                free(tmp);
+                long long value;
+
+                if (json_bind_load_integer(field, size, &value)) {
+                    written += json_set_integer(obj, bindings[i].path, separator, value);
+                }
                 break;
             }
             case Floating: {
-                needed = snprintf(NULL, 0, "%Lf%s", obj->settings[i]->double_type, i == obj->settings_count - 1 ? "" : ",") + 1;
-                tmp = malloc(needed);
-                sprintf(tmp, "%Lf%s", obj->settings[i]->double_type, i == obj->settings_count - 1 ? "" : ",");
-                str = json_strcat(str, tmp);
-                free(tmp);
+                long double value;
+
+                if (size == sizeof(float)) {
+                    value = *(const float*)field;
+                } else if (size == sizeof(double)) {
+                    value = *(const double*)field;
+                } else if (size == sizeof(long double)) {
+                    value = *(const long double*)field;
+                } else {
+                    break;
+                }
+                written += json_set_floating(obj, bindings[i].path, separator, value);
                 break;
             }
             case String: {
-                needed = snprintf(NULL, 0, "\"%s\"%s", obj->settings[i]->string_type, i == obj->settings_count - 1 ? "" : ",") + 1;
-                tmp = malloc(needed);
-                sprintf(tmp, "\"%s\"%s", obj->settings[i]->string_type, i == obj->settings_count - 1 ? "" : ",");
-                str = json_strcat(str, tmp);
-                free(tmp);
+                size_t len = strnlen(field, size);
+                char* value = json_malloc(NULL, len + 1);
+
+                memcpy(value, field, len);
+                value[len] = '\0';
+                written += json_set_string(obj, bindings[i].path, separator, value);
+                json_dealloc(NULL, value);
                 break;
             }
             case Object: {
-                if (obj->settings[i]->obj_type == NULL) {
-                    needed = snprintf(NULL, 0, "null%s", i == obj->settings_count - 1 ? "" : ",") + 1;
-                    tmp = malloc(needed);
-                    sprintf(tmp, "null%s", i == obj->settings_count - 1 ? "" : ",");
-                    str = json_strcat(str, tmp);
-                    free(tmp);
-                    break;
-                }
-
-                char* dump = json_dump(obj->settings[i]->obj_type, 0);
-                needed = snprintf(NULL, 0, "%s%s", dump, i == obj->settings_count - 1 ? "" : ",") + 1;
-                tmp = malloc(needed);
-                sprintf(tmp, "%s%s", dump, i == obj->settings_count - 1 ? "" : ",");
-                str = json_strcat(str, tmp);
-                free(tmp);
-                free(dump);
                 break;
             }
         }
     }
 
-    str = json_strcat(str, "}");
+    return written;
+}
 
-    if (format) {
-        char* formatted = json_format(str);
-        free(str);
-        return formatted;
-    } else {
-        return str;
+/**
+ * Maximum depth of nested maps accepted by json_msgpack_decode
+ */
+#define JSON_MSGPACK_MAX_DEPTH 512
+
+/**
+ * Appends a MessagePack type byte followed by a big-endian value
+ * @param buf Buffer to append to
+ * @param type Type byte
+ * @param value Value
+ * @param size Size of the value in bytes (0, 1, 2, 4 or 8)
+ */
+void json_msgpack_put(json_buf_t* buf, unsigned char type, unsigned long long value, size_t size) {
+    char bytes[9];
+
+    bytes[0] = (char)type;
+    for (size_t i = 0; i < size; i++) {
+        bytes[1 + i] = (char)(value >> (8 * (size - 1 - i)));
     }
+
+    json_buf_append(buf, bytes, size + 1);
 }
 
 /**
- * Prints a JSON object on the standard output. Memory handled
- * @param obj Object to print
- * @param format Boolean; Format the output (1) or no (0)?
+ * Appends a MessagePack string
+ * @param buf Buffer to append to
+ * @param str String
  */
-void json_print(json_obj_t* obj, int format) {
-    char* dump = json_dump(obj, format);
+void json_msgpack_put_string(json_buf_t* buf, const char* str) {
+    size_t len = strlen(str);
 
-    printf("%s\n", dump);
-    free(dump);
+    if (len < 32) {
+        json_msgpack_put(buf, 0xa0 | len, 0, 0);
+    } else if (len <= 0xff) {
+        json_msgpack_put(buf, 0xd9, len, 1);
+    } else if (len <= 0xffff) {
+        json_msgpack_put(buf, 0xda, len, 2);
+    } else {
+        json_msgpack_put(buf, 0xdb, len, 4);
+    }
+
+    json_buf_append(buf, str, len);
 }
 
 /**
- * Writes a JSON object to disk
- * @param json Object to save
- * @param path Path to file that will contain the object
- * @return 0 on error, 1 on success.
+ * Appends a MessagePack integer in its smallest form
+ * @param buf Buffer to append to
+ * @param value Integer
  */
-int json_save(json_obj_t* json, const char* path) {
-    if (access(path, F_OK) == 0) {
-        if (unlink(path) == -1) {
-            return 0;
+void json_msgpack_put_integer(json_buf_t* buf, long long value) {
+    if (value >= 0) {
+        if (value < 0x80) {
+            json_msgpack_put(buf, value, 0, 0);
+        } else if (value <= 0xff) {
+            json_msgpack_put(buf, 0xcc, value, 1);
+        } else if (value <= 0xffff) {
+            json_msgpack_put(buf, 0xcd, value, 2);
+        } else if (value <= 0xffffffffLL) {
+            json_msgpack_put(buf, 0xce, value, 4);
+        } else {
+            json_msgpack_put(buf, 0xcf, value, 8);
         }
+    } else if (value >= -32) {
+        json_msgpack_put(buf, (unsigned char)value, 0, 0);
+    } else if (value >= INT8_MIN) {
+        json_msgpack_put(buf, 0xd0, (unsigned long long)value, 1);
+    } else if (value >= INT16_MIN) {
+        json_msgpack_put(buf, 0xd1, (unsigned long long)value, 2);
+    } else if (value >= INT32_MIN) {
+        json_msgpack_put(buf, 0xd2, (unsigned long long)value, 4);
+    } else {
+        json_msgpack_put(buf, 0xd3, (unsigned long long)value, 8);
     }
+}
 
-    int fd = open(path, O_RDWR | O_CREAT, 0600);
+/**
+ * Appends an object as a MessagePack map
+ * @param buf Buffer to append to
+ * @param obj Object to encode
+ */
+void json_msgpack_put_object(json_buf_t* buf, json_obj_t* obj) {
+    size_t count = obj->settings_count;
 
-    if (fd == -1) {
+    if (count < 16) {
+        json_msgpack_put(buf, 0x80 | count, 0, 0);
+    } else if (count <= 0xffff) {
+        json_msgpack_put(buf, 0xde, count, 2);
+    } else {
+        json_msgpack_put(buf, 0xdf, count, 4);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        json_setting_t* setting = obj->settings[i];
+
+        json_msgpack_put_string(buf, setting->name);
+
+        switch (setting->type) {
+            case Boolean: {
+                json_msgpack_put(buf, setting->bool_type ? 0xc3 : 0xc2, 0, 0);
+                break;
+            }
+            case Integer: {
+                json_msgpack_put_integer(buf, setting->long_type);
+                break;
+            }
+            case Floating: {
+                double value = (double)setting->double_type;
+                unsigned long long bits;
+
+                memcpy(&bits, &value, sizeof(bits));
+                json_msgpack_put(buf, 0xcb, bits, 8);
+                break;
+            }
+            case String: {
+                json_msgpack_put_string(buf, setting->string_type);
+                break;
+            }
+            case Object: {
+                if (setting->obj_type == NULL) {
+                    json_msgpack_put(buf, 0xc0, 0, 0);
+                } else {
+                    json_msgpack_put_object(buf, setting->obj_type);
+                }
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * Encodes an object in MessagePack: objects are maps, null is nil, floating point numbers are float 64
+ * and integers take their smallest form.
+ * @param obj Object to encode
+ * @param data Buffer to write to, reused from one call to the next and grown when needed (a NULL buffer is
+ * allocated), to free with json_free_string
+ * @param cap Capacity of the buffer, updated when it grows
+ * @return Length of the encoded object, 0 on error
+ */
+size_t json_msgpack_encode(json_obj_t* obj, char** data, size_t* cap) {
+    if (obj == NULL || data == NULL || cap == NULL) {
+        return 0;
+    }
+
+    unsigned long long start = json_now_ns();
+    json_buf_t buf = { *data, 0, *data != NULL ? *cap : 0, NULL, 0, 0 };
+
+    json_msgpack_put_object(&buf, obj);
+    json_record(obj->doc, TraceDump, buf.len, start);
+
+    *data = buf.data;
+    *cap = buf.cap;
+    return buf.len;
+}
+
+/**
+ * Reader of json_msgpack_decode
+ */
+typedef struct json_msgpack_reader_s {
+    const unsigned char* data;
+    size_t len;
+    size_t pos;
+    json_doc_t* doc;
+} json_msgpack_reader_t;
+
+/**
+ * Reads a big-endian value
+ * @param reader Reader
+ * @param size Size of the value in bytes
+ * @param value Set to the value
+ * @return 0 if the data is too short, 1 on success
+ */
+int json_msgpack_get(json_msgpack_reader_t* reader, size_t size, unsigned long long* value) {
+    if (reader->len - reader->pos < size) {
+        return 0;
+    }
+
+    *value = 0;
+    for (size_t i = 0; i < size; i++) {
+        *value = (*value << 8) | reader->data[reader->pos++];
+    }
+
+    return 1;
+}
+
+/**
+ * Reads the length of a MessagePack string
+ * @param reader Reader, on the type byte
+ * @param len Set to the length of the string, which is checked to fit in the data
+ * @return 0 if the next value isn't a string, 1 on success
+ */
+int json_msgpack_get_string_len(json_msgpack_reader_t* reader, size_t* len) {
+    unsigned long long value;
+    unsigned char type;
+
+    if (reader->pos >= reader->len) {
+        return 0;
+    }
+
+    type = reader->data[reader->pos++];
+
+    if ((type & 0xe0) == 0xa0) {
+        value = type & 0x1f;
+    } else if (type < 0xd9 || type > 0xdb || json_msgpack_get(reader, 1 << (type - 0xd9), &value) == 0) {
+        return 0;
+    }
+
+    if (value > reader->len - reader->pos) {
         return 0;
     }
 
-    char* str = json_dump(json, 0);
-    write(fd, str, strlen(str));
-
-    free(str);
+    *len = value;
     return 1;
 }
 
+json_obj_t* json_msgpack_get_object(json_msgpack_reader_t* reader, unsigned long long count, size_t depth);
+
 /**
- * Gets length of key array from string
- * @param str Key array (ex: "object1.object2.setting")
- * @return The number of keys in the string (ex: 3)
+ * Reads a MessagePack string that is stored in a setting, as a name or a value: it must be valid UTF-8,
+ * without NUL characters
+ * @param reader Reader, on the type byte
+ * @param len Set to the length of the string, which starts at the new position of the reader
+ * @return 0 if the next value isn't a valid string, 1 on success
  */
-size_t json_get_key_array_len(const char* str) {
-    size_t count = 0;
+int json_msgpack_get_text(json_msgpack_reader_t* reader, size_t* len) {
+    if (json_msgpack_get_string_len(reader, len) == 0) {
+        return 0;
+    }
 
-    for (int i = 0; str[i] != '\0'; i++) {
-        if (str[i] == '.') { count++; }
+    const unsigned char* str = reader->data + reader->pos;
+
+    for (size_t i = 0, n; i < *len; i += n) {
+        n = str[i] != '\0' ? json_utf8_sequence(str + i, *len - i) : 0;
+
+        if (n == 0) {
+            return 0;
+        }
     }
-    return count + 1;
+
+    return 1;
 }
 
 /**
- * Splits a string representing array of strings like
- * @param str Key array (ex: "object1.object2.setting")
- * @param separator Separator to split keys in the string
- * @return A NULL-terminated array of key strings
+ * Reads a MessagePack value into a setting
+ * @param reader Reader, on the type byte
+ * @param setting Setting to fill (its name is already set)
+ * @param depth Depth of the map holding the value
+ * @return 0 if the value is invalid or of an unsupported type (array, binary, extension), 1 on success
  */
-char** json_get_key_array(const char* str, const char separator) {
-    size_t len = strlen(str);
-    char* double_sep = malloc(3);
-    double_sep[0] = separator;
-    double_sep[1] = separator;
-    double_sep[2] = '\0';
+int json_msgpack_get_value(json_msgpack_reader_t* reader, json_setting_t* setting, size_t depth) {
+    unsigned long long value;
 
-    if (strstr(str, double_sep) != NULL || str[0] == separator || str[len - 1] == separator) {
-        free(double_sep);
-        return NULL;
+    if (reader->pos >= reader->len) {
+        return 0;
     }
 
-    free(double_sep);
+    unsigned char type = reader->data[reader->pos];
 
-    size_t arr_len = json_get_key_array_len(str);
-    char** str_array = malloc(sizeof(char*) * (arr_len + 1));
-    str_array[arr_len] = NULL;
+    if ((type & 0xe0) == 0xa0 || (type >= 0xd9 && type <= 0xdb)) {
+        size_t len;
 
-    for (size_t i = 0, j = 0, k = 0; str[i] != '\0'; i++) {
-        if (str[i] == separator || i == len - 1) {
-            int offset = (i == len - 1) ? 2 : 1;
-
-            str_array[j] = malloc(i - k + offset);
-            str_array[j][i - k + offset - 1] = '\0';
-            strncpy(str_array[j], &str[k], i - k + offset - 1);
-            k = i + 1;
-            j++;
-            continue;
+        if (json_msgpack_get_text(reader, &len) == 0) {
+            return 0;
         }
+
+        setting->type = String;
+        setting->string_type = json_malloc(reader->doc, len + 1);
+        json_set_string_cap(setting, len + 1);
+        memcpy(setting->string_type, reader->data + reader->pos, len);
+        setting->string_type[len] = '\0';
+        reader->pos += len;
+        return 1;
     }
 
-    return str_array;
-}
+    reader->pos++;
 
-/**
- * Get first corresponding string setting
- * @param obj Object to search
- * @param key_array Key array
- * @return Corresponding setting or NULL if not found
- */
-json_setting_t* json_get_setting(json_obj_t* obj, char** key_array, int remove) {
-    if (obj == NULL) {
-        return NULL;
+    if (type < 0x80 || type >= 0xe0) {
+        setting->type = Integer;
+        setting->long_type = type < 0x80 ? type : (signed char)type;
+        return 1;
     }
 
-    size_t key_count = json_key_count(key_array);
+    if ((type & 0xf0) == 0x80 || type == 0xde || type == 0xdf) {
+        if ((type & 0xf0) == 0x80) {
+            value = type & 0x0f;
+        } else if (json_msgpack_get(reader, type == 0xde ? 2 : 4, &value) == 0) {
+            return 0;
+        }
 
-    for (size_t i = 0; i < obj->settings_count; i++) {
-        if (strcmp(obj->settings[i]->name, key_array[0]) == 0) {
-            if (obj->settings[i]->type == Object && key_count - 1 != 0) {
-                return json_get_setting(obj->settings[i]->obj_type, &key_array[1], remove);
-            } else {
-                json_setting_t* ret = obj->settings[i];
+        setting->type = Object;
+        setting->obj_type = json_msgpack_get_object(reader, value, depth + 1);
+        return setting->obj_type != NULL;
+    }
 
-                if (remove) {
-                    if (i != obj->settings_count - 1) {
-                        for (size_t j = 0; j < obj->settings_count - i - 1; j++) {
-                            obj->settings[i + j] = obj->settings[i + j + 1];
-                        }
-                    }
+    switch (type) {
+        case 0xc0: {
+            setting->type = Object;
+            setting->obj_type = NULL;
+            return 1;
+        }
+        case 0xc2:
+        case 0xc3: {
+            setting->type = Boolean;
+            setting->bool_type = type == 0xc3;
+            return 1;
+        }
+        case 0xca:
+        case 0xcb: {
+            if (json_msgpack_get(reader, type == 0xca ? 4 : 8, &value) == 0) {
+                return 0;
+            }
 
-                    json_setting_t** tmp = realloc(obj->settings, (obj->settings_count - 1) * sizeof(json_setting_t*));
+            setting->type = Floating;
+            if (type == 0xca) {
+                float f;
+                uint32_t bits = (uint32_t)value;
 
-                    if (tmp == NULL && obj->settings_count > 1) {
-                        exit(1);
-                    }
+                memcpy(&f, &bits, sizeof(f));
+                setting->double_type = f;
+            } else {
+                double d;
 
-                    obj->settings_count -= 1;
-                    obj->settings = tmp;
-                }
+                memcpy(&d, &value, sizeof(d));
+                setting->double_type = d;
+            }
+            return 1;
+        }
+        case 0xcc:
+        case 0xcd:
+        case 0xce:
+        case 0xcf: {
+            if (json_msgpack_get(reader, 1 << (type - 0xcc), &value) == 0 || value > LLONG_MAX) {
+                return 0;
+            }
+
+            setting->type = Integer;
+            setting->long_type = (long long)value;
+            return 1;
+        }
+        case 0xd0:
+        case 0xd1:
+        case 0xd2:
+        case 0xd3: {
+            size_t size = 1 << (type - 0xd0);
+
+            if (json_msgpack_get(reader, size, &value) == 0) {
+                return 0;
+            }
 
-                return ret;
+            /* Sign extension of the big-endian value */
+            if (size < 8 && (value >> (size * 8 - 1)) != 0) {
+                value |= ~0ULL << (size * 8);
             }
+
+            setting->type = Integer;
+            setting->long_type = (long long)value;
+            return 1;
+        }
+        default: {
+            return 0;
         }
     }
-
-    return NULL;
 }
 
 /**
- * Get corresponding string setting
- * @param obj Object to search
- * @param str Key array like (ex: "object.setting")
- * @param separator Char separator separating the keys in the string
- * @return Corresponding setting or NULL if error happens
+ * Reads the members of a MessagePack map into a new object. The count is known upfront, so the settings are
+ * allocated at once and every key and string is copied by length without being scanned.
+ * @param reader Reader, after the map header
+ * @param count Number of members of the map
+ * @param depth Depth of the map
+ * @return The object, or NULL if the map is invalid
  */
-char* json_get_string(json_obj_t* obj, const char* str, char separator) {
-    char** key_array = json_get_key_array(str, separator);
-    json_setting_t* setting = json_get_setting(obj, key_array, 0);
-
-    json_free_double_char_array(key_array);
-
-    if (setting == NULL || setting->type != String) {
-        printf("error: can't find %s, or it isn't a string\n", str);
+json_obj_t* json_msgpack_get_object(json_msgpack_reader_t* reader, unsigned long long count, size_t depth) {
+    /* Each member takes at least two bytes, a bigger count can't be right and isn't allocated */
+    if (depth > JSON_MSGPACK_MAX_DEPTH || count > (reader->len - reader->pos) / 2) {
         return NULL;
     }
 
-    return setting->string_type;
-}
+    json_obj_t* obj = json_new_object(reader->doc);
 
-/**
- * Get corresponding boolean setting
- * @param obj Object to search
- * @param str Key array like (ex: "object.setting")
- * @param separator Char separator separating the keys in the string (ex: '.')
- * @return Correct boolean value or 0 if nothing is found
- */
-int json_get_bool(json_obj_t* obj, const char* str, char separator) {
-    char** key_array = json_get_key_array(str, separator);
-    json_setting_t* setting = json_get_setting(obj, key_array, 0);
+    obj->settings = json_malloc(reader->doc, sizeof(json_setting_t*) * (count + 1));
 
-    json_free_double_char_array(key_array);
+    for (; obj->settings_count < count; obj->settings_count++) {
+        json_setting_t* setting = json_malloc(reader->doc, sizeof(json_setting_t));
+        size_t len;
 
-    if (setting == NULL || setting->type != Boolean) {
-        printf("error: can't find %s, or it isn't a bool\n", str);
-        return 0;
+        setting->type = Boolean;
+        obj->settings[obj->settings_count] = setting;
+
+        if (json_msgpack_get_text(reader, &len) == 0) {
+            obj->settings_count++;
+            json_free(obj);
+            return NULL;
+        }
+
+        setting->name = json_intern(reader->doc, (const char*)reader->data + reader->pos, len);
+        reader->pos += len;
+
+        if (json_msgpack_get_value(reader, setting, depth) == 0) {
+            setting->type = Boolean;
+            obj->settings_count++;
+            json_free(obj);
+            return NULL;
+        }
     }
 
-    return setting->bool_type;
+    return obj;
 }
 
 /**
- * Get corresponding integer setting
- * @param obj Object to search
- * @param str Key array like (ex: "object.setting")
- * @param separator Char separator separating the keys in the string (ex: '.')
- * @return Corresponding setting or 0 if error happens
+ * Decodes a MessagePack map into an object. Keys must be strings, and values nil, booleans, integers,
+ * floating point numbers, strings or maps. Strings, keys included, must be valid UTF-8 without NUL characters.
+ * @param data Encoded object
+ * @param len Length of the encoded object
+ * @return The object, or NULL if the data is invalid
  */
-long long json_get_integer(json_obj_t* obj, const char* str, char separator) {
-    char** key_array = json_get_key_array(str, separator);
-    json_setting_t* setting = json_get_setting(obj, key_array, 0);
+json_obj_t* json_msgpack_decode(const char* data, size_t len) {
+    unsigned long long start = json_now_ns();
+    json_msgpack_reader_t reader = { (const unsigned char*)data, len, 0, json_doc_new(NULL, NULL) };
 
-    json_free_double_char_array(key_array);
+    if (reader.doc == NULL) {
+        return NULL;
+    }
 
-    if (setting == NULL || setting->type != Integer) {
-        printf("error: can't find %s, or it isn't an integer\n", str);
-        return 0;
+    json_setting_t root = { .type = Boolean };
+    json_obj_t* obj = NULL;
+    int is_map = len > 0 && ((reader.data[0] & 0xf0) == 0x80 || reader.data[0] == 0xde || reader.data[0] == 0xdf);
+
+    if (is_map && json_msgpack_get_value(&reader, &root, 0) && reader.pos == len) {
+        obj = root.obj_type;
+    } else if (root.type == Object && root.obj_type != NULL) {
+        json_free(root.obj_type);
     }
 
-    return setting->long_type;
+    json_record(reader.doc, TraceParse, len, start);
+    json_doc_release(reader.doc);
+    return obj;
 }
 
 /**
- * Get corresponding object setting
- * @param obj Object to search
- * @param str Key array like (ex: "object.setting")
- * @param separator Char separator separating the keys in the string (ex: '.')
- * @return Corresponding setting or NULL if error happens
+ * Finds the end of a string in raw JSON text, 16 bytes at a time with SSE2
+ * @param text JSON text
+ * @param len Length of the text
+ * @param pos Index of the opening quote
+ * @return Index after the closing quote, SIZE_MAX if the string isn't terminated
  */
-json_obj_t* json_get_object(json_obj_t* obj, const char* str, char separator) {
-    char** key_array = json_get_key_array(str, separator);
-    json_setting_t* setting = json_get_setting(obj, key_array, 0);
+size_t json_skip_string(const char* text, size_t len, size_t pos) {
+    size_t i = pos + 1;
 
-    json_free_double_char_array(key_array);
+    while (i < len) {
+#ifdef __SSE2__
+        const __m128i quote = _mm_set1_epi8('\"');
+        const __m128i backslash = _mm_set1_epi8('\\');
 
-    if (setting == NULL || setting->type != Object) {
-        printf("error: can't find %s, or it isn't an object\n", str);
-        return NULL;
+        for (; i + 16 <= len; i += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(text + i));
+            int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, quote), _mm_cmpeq_epi8(block, backslash)));
+
+            if (mask != 0) {
+                i += __builtin_ctz(mask);
+                break;
+            }
+        }
+#endif
+        for (; i < len && text[i] != '\"' && text[i] != '\\'; i++) {
+        }
+
+        if (i >= len) {
+            break;
+        }
+        if (text[i] == '\"') {
+            return i + 1;
+        }
+        i += 2;
     }
 
-    return setting->obj_type;
+    return SIZE_MAX;
 }
 
 /**
- * Get corresponding floating point number setting
- * @param obj Object to search
- * @param str Key array like (ex: "object.setting")
- * @param separator Char separator separating the keys in the string (ex: '.')
- * @return Corresponding value or 0 if error happens
+ * Finds the end of an object or array in raw JSON text by balancing brackets, without looking at its
+ * members. Structural characters are located 16 bytes at a time with SSE2.
+ * @param text JSON text
+ * @param len Length of the text
+ * @param pos Index of the opening bracket
+ * @return Index after the closing bracket, SIZE_MAX if it isn't closed
  */
-long double json_get_floating(json_obj_t* obj, const char* str, char separator) {
-    char** key_array = json_get_key_array(str, separator);
-    json_setting_t* setting = json_get_setting(obj, key_array, 0);
+size_t json_skip_container(const char* text, size_t len, size_t pos) {
+    size_t depth = 0;
+    size_t i = pos;
+
+    while (i < len) {
+#ifdef __SSE2__
+        for (; i + 16 <= len; i += 16) {
+            __m128i block = _mm_loadu_si128((const __m128i*)(text + i));
+            /* '[' and ']', '{' and '}' only differ by 0x20, or-ing it folds them together */
+            __m128i folded = _mm_or_si128(block, _mm_set1_epi8(0x20));
+            __m128i special = _mm_cmpeq_epi8(block, _mm_set1_epi8('\"'));
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(folded, _mm_set1_epi8('{')));
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(folded, _mm_set1_epi8('}')));
+
+            int mask = _mm_movemask_epi8(special);
+
+            if (mask != 0) {
+                i += __builtin_ctz(mask);
+                break;
+            }
+        }
+#endif
+        for (; i < len; i++) {
+            char c = text[i];
+
+            if (c == '\"' || c == '{' || c == '}' || c == '[' || c == ']') {
+                break;
+            }
+        }
 
-    json_free_double_char_array(key_array);
+        if (i >= len) {
+            break;
+        }
 
-    if (setting == NULL || setting->type != Floating) {
-        printf("error: can't find %s, or it isn't a floating point number\n", str);
-        return 0;
+        if (text[i] == '\"') {
+            i = json_skip_string(text, len, i);
+            continue;
+        }
+
+        if (text[i] == '{' || text[i] == '[') {
+            depth++;
+        } else if (--depth == 0) {
+            return i + 1;
+        }
+        i++;
     }
 
-    return setting->double_type;
+    return SIZE_MAX;
 }
 
 /**
- * Removes a setting from an object at specified key
- * @param obj Object to search in
- * @param key Key to setting
- * @param separator Separator
- * @return 0 if obj is NULL, if setting doesn't exist, 1 on success
+ * Finds the end of any value in raw JSON text
+ * @param text JSON text
+ * @param len Length of the text
+ * @param pos Index of the first character of the value
+ * @return Index after the value, SIZE_MAX if it is invalid
  */
-int json_remove_setting(json_obj_t* obj, const char* key, char separator) {
-    if (obj == NULL) {
-        return 0;
+size_t json_skip_value(const char* text, size_t len, size_t pos) {
+    if (pos >= len) {
+        return SIZE_MAX;
     }
 
-    char** key_array = json_get_key_array(key, separator);
-    json_setting_t* setting = json_get_setting(obj, key_array, 1);
+    if (text[pos] == '\"') {
+        return json_skip_string(text, len, pos);
+    }
+    if (text[pos] == '{' || text[pos] == '[') {
+        return json_skip_container(text, len, pos);
+    }
 
-    json_free_double_char_array(key_array);
-    json_free_setting(setting);
+    size_t i = pos;
+    while (i < len && text[i] != ',' && text[i] != '}' && text[i] != ']' && !json_is_invisible(text[i])) {
+        i++;
+    }
 
-    return 1;
+    return i > pos ? i : SIZE_MAX;
 }
 
 /**
- * Creates a string setting and returns a pointer to it
- * @param name Name of the setting
- * @param value Value of the setting
- * @return The created setting
+ * Skips whitespace in raw JSON text
+ * @param text JSON text
+ * @param len Length of the text
+ * @param pos Index to start from
+ * @return Index of the next visible character, or len
  */
-json_setting_t* json_create_string_setting(const char* name, const char* value) {
-    json_setting_t* setting = malloc(sizeof(json_setting_t));
-
-    setting->type = String;
-    setting->name = malloc(strlen(name) + 1);
-    strcpy(setting->name, name);
-    setting->string_type = malloc(strlen(value) + 1);
-    strcpy(setting->string_type, value);
+size_t json_skip_invisible(const char* text, size_t len, size_t pos) {
+    while (pos < len && json_is_invisible(text[pos])) {
+        pos++;
+    }
 
-    return setting;
+    return pos;
 }
 
 /**
- * Creates a boolean setting and returns a pointer to it
- * @param name Name of the setting
- * @param value Value of the setting
- * @return The created setting
+ * Compares a raw key name of JSON text to a key, decoding the escape sequences of the raw key if it has any
+ * @param raw Raw key name, without its quotes
+ * @param raw_len Length of the raw key name
+ * @param key Key
+ * @param key_len Length of the key
+ * @return Boolean value
  */
-json_setting_t* json_create_bool_setting(const char* name, int value) {
-    json_setting_t* setting = malloc(sizeof(json_setting_t));
+int json_raw_key_equal(const char* raw, size_t raw_len, const char* key, size_t key_len) {
+    if (memchr(raw, '\\', raw_len) == NULL) {
+        return raw_len == key_len && memcmp(raw, key, key_len) == 0;
+    }
 
-    setting->type = Boolean;
-    setting->name = malloc(strlen(name) + 1);
-    strcpy(setting->name, name);
-    setting->bool_type = value;
+    size_t j = 0;
 
-    return setting;
-}
+    for (size_t i = 0; i < raw_len;) {
+        char decoded[4];
+        size_t written = 1;
+        size_t consumed = 1;
 
-/**
- * Creates a integer setting and returns a pointer to it
- * @param name Name of the setting
- * @param value Value of the setting
- * @return The created setting
- */
-json_setting_t* json_create_integer_setting(const char* name, long long value) {
-    json_setting_t* setting = malloc(sizeof(json_setting_t));
+        if (raw[i] == '\\') {
+            consumed = json_unescape_sequence(raw + i + 1, raw_len - i - 1, decoded, &written);
+            if (consumed++ == 0) {
+                return 0;
+            }
+        } else {
+            decoded[0] = raw[i];
+        }
 
-    setting->type = Integer;
-    setting->name = malloc(strlen(name) + 1);
-    strcpy(setting->name, name);
-    setting->long_type = value;
+        if (j + written > key_len || memcmp(key + j, decoded, written) != 0) {
+            return 0;
+        }
 
-    return setting;
+        i += consumed;
+        j += written;
+    }
+
+    return j == key_len;
 }
 
 /**
- * Creates a floating point setting and returns a pointer to it
- * @param name Name of the setting
- * @param value Value of the setting
- * @return The created setting
+ * Reads a value of raw JSON text
+ * @param text Value
+ * @param len Length of the value
+ * @param out Filled with the type and value
+ * @return 0 if the value is invalid (or an array), 1 on success
  */
-json_setting_t* json_create_floating_setting(const char* name, long double value) {
-    json_setting_t* setting = malloc(sizeof(json_setting_t));
+int json_extract_value(const char* text, size_t len, json_extract_t* out) {
+    out->text = text;
+    out->len = len;
+
+    if (text[0] == '\"') {
+        out->type = String;
+        out->text = text + 1;
+        out->len = len - 2;
+        return 1;
+    }
+    if (text[0] == '{') {
+        out->type = Object;
+        return 1;
+    }
+    if (len == 4 && memcmp(text, "null", 4) == 0) {
+        out->type = Object;
+        return 1;
+    }
+    if ((len == 4 && memcmp(text, "true", 4) == 0) || (len == 5 && memcmp(text, "false", 5) == 0)) {
+        out->type = Boolean;
+        out->bool_type = text[0] == 't';
+        return 1;
+    }
+    if (text[0] != '-' && (text[0] < '0' || text[0] > '9')) {
+        return 0;
+    }
 
-    setting->type = Floating;
-    setting->name = malloc(strlen(name) + 1);
-    strcpy(setting->name, name);
-    setting->double_type = value;
+    /* The text isn't NUL-terminated, numbers are copied to the stack */
+    char number[64];
+    char* end;
 
-    return setting;
-}
+    if (len >= sizeof(number)) {
+        return 0;
+    }
 
-/**
- * Creates a integer setting and returns a pointer to it
- * @param name Name of the setting
- * @param value Value of the setting
- * @return The created setting
- */
-json_setting_t* json_create_object_setting(const char* name, json_obj_t* value) {
-    json_setting_t* setting = malloc(sizeof(json_setting_t));
+    memcpy(number, text, len);
+    number[len] = '\0';
 
-    setting->type = Object;
-    setting->name = malloc(strlen(name) + 1);
-    strcpy(setting->name, name);
-    setting->obj_type = value;
+    if (strpbrk(number, ".eE") != NULL) {
+        out->type = Floating;
+        out->double_type = strtold(number, &end);
+    } else {
+        out->type = Integer;
+        out->long_type = strtoll(number, &end, 10);
+    }
 
-    return setting;
+    return *end == '\0';
 }
 
 /**
- * Adds a setting to an object. If the object is already containing a setting with this name, it will
- * automatically be overwritten by the new one.
- * @param obj Object to which add the setting
- * @param setting Setting to add to the object
- * @param key_array Array of keys containing the path
- * @return 0 on failure, 1 on success
+ * Gets a single value from JSON text without building objects: only the members on the key path are
+ * descended into, every other value is skipped by balancing its quotes and brackets. Nothing is allocated.
+ * @param text JSON text
+ * @param len Length of the text, which doesn't need to be NUL-terminated
+ * @param key Key path (ex: "object.setting")
+ * @param separator Char separator separating the keys in the path
+ * @param out Filled with the type and value. Its span (text, len) points into the text: the raw content
+ * between the quotes for a string (escape sequences aren't decoded), the whole value for an object or null.
+ * @return 0 if the path doesn't exist or the text is invalid on the way, 1 on success
  */
-int json_add_setting(json_obj_t* obj, json_setting_t* setting, char** key_array, size_t key_count) {
-    if (obj == NULL) {
+int json_extract(const char* text, size_t len, const char* key, char separator, json_extract_t* out) {
+    size_t pos = json_skip_invisible(text, len, 0);
+
+    if (pos >= len || text[pos] != '{') {
         return 0;
     }
+    pos++;
 
-    json_setting_t* old_setting = json_get_setting(obj, key_array, 1);
-    json_free_setting(old_setting);
+    for (;;) {
+        const char* end = strchr(key, separator);
+        size_t key_len = end != NULL ? (size_t)(end - key) : strlen(key);
+        int found = 0;
 
-    for (size_t i = 0; i < obj->settings_count; i++) {
-        if (strcmp(obj->settings[i]->name, key_array[0]) == 0 && key_count > 1) {
-            if (obj->settings[i]->type == Object && key_count - 1 != 0) {
-                return json_add_setting(obj->settings[i]->obj_type, setting, &key_array[1], key_count - 1);
-            }
-        } else {
-            json_obj_t* obj_new = malloc(sizeof(json_obj_t));
+        while (!found) {
+            pos = json_skip_invisible(text, len, pos);
 
-            obj_new->settings_count = obj->settings_count + 1;
-            obj_new->settings = malloc(sizeof(json_setting_t*) * (obj->settings_count + 1));
-            for(size_t j = 0; j < obj->settings_count; j++) {
-                obj_new->settings[j] = malloc(sizeof(json_setting_t));
-                *(obj_new->settings[j]) = *(obj->settings[j]);
+            if (pos >= len || text[pos] != '\"') {
+                return 0;
             }
-            obj_new->settings[obj->settings_count] = setting;
 
-            for(size_t j = 0; j < obj->settings_count; j++) {
-                free(obj->settings[j]);
+            size_t name_end = json_skip_string(text, len, pos);
+
+            if (name_end == SIZE_MAX) {
+                return 0;
             }
-            free(obj->settings);
 
-            *obj = *obj_new;
-            free(obj_new);
-            return 1;
-        }
-    }
+            found = json_raw_key_equal(text + pos + 1, name_end - pos - 2, key, key_len);
+            pos = json_skip_invisible(text, len, name_end);
 
-    return 0;
-}
+            if (pos >= len || text[pos] != ':') {
+                return 0;
+            }
+            pos = json_skip_invisible(text, len, pos + 1);
 
-/**
- * Sets a string setting at the desired key
- * @param obj Object in which set the setting
- * @param key Key path at which set the setting (ex: object.object.setting)
- * @param separator Separator of keys in key path
- * @param value Value to set in the setting
- * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
- */
-int json_set_string(json_obj_t* obj, const char* key, char separator, const char* value) {
-    char** key_array = json_get_key_array(key, separator);
-    size_t key_count = json_key_count(key_array);
-    json_setting_t* setting = json_create_string_setting(key_array[key_count - 1], value);
-    int ret = json_add_setting(obj, setting, key_array, key_count);
+            if (found) {
+                break;
+            }
 
-    json_free_double_char_array(key_array);
+            pos = json_skip_value(text, len, pos);
+            pos = pos == SIZE_MAX ? len : json_skip_invisible(text, len, pos);
 
-    return ret;
-}
+            if (pos >= len || text[pos] != ',') {
+                return 0;
+            }
+            pos++;
+        }
 
-/**
- * Sets a boolean setting at the desired key
- * @param obj Object in which set the setting
- * @param key Key path at which set the setting (ex: object.object.setting)
- * @param separator Separator of keys in key path
- * @param value Value to set in the setting
- * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
- */
-int json_set_bool(json_obj_t* obj, const char* key, char separator, int value) {
-    char** key_array = json_get_key_array(key, separator);
-    size_t key_count = json_key_count(key_array);
-    int ret = json_add_setting(obj, json_create_bool_setting(key_array[key_count - 1], value), key_array, key_count);
+        if (end == NULL) {
+            size_t value_end = json_skip_value(text, len, pos);
+            return value_end != SIZE_MAX && json_extract_value(text + pos, value_end - pos, out);
+        }
 
-    json_free_double_char_array(key_array);
+        if (pos >= len || text[pos] != '{') {
+            return 0;
+        }
 
-    return ret;
+        key = end + 1;
+        pos++;
+    }
 }
 
 /**
- * Sets a integer setting at the desired key
- * @param obj Object in which set the setting
- * @param key Key path at which set the setting (ex: object.object.setting)
- * @param separator Separator of keys in key path
- * @param value Value to set in the setting
- * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ * Gets the statistics of an object's document, or the global ones. Statistics are only collected when the
+ * library is built with JSON_STATS, otherwise they are all zero.
+ * @param obj Object whose document statistics to get (shared by every object parsed from the same text),
+ * NULL for the global statistics of all documents and temporary allocations
+ * @param stats Filled with a snapshot of the counters
+ * @return 0 if statistics are not compiled in, 1 otherwise
  */
-int json_set_integer(json_obj_t* obj, const char* key, char separator, long long value) {
-    char** key_array = json_get_key_array(key, separator);
-    size_t key_count = json_key_count(key_array);
-    int ret = json_add_setting(obj, json_create_integer_setting(key_array[key_count - 1], value), key_array, key_count);
+int json_get_stats(json_obj_t* obj, json_stats_t* stats) {
+    const unsigned long long* src = (const unsigned long long*)(obj != NULL ? &obj->doc->owner->stats : &json_global_stats);
+    unsigned long long* dest = (unsigned long long*)stats;
 
-    json_free_double_char_array(key_array);
+    for (size_t i = 0; i < sizeof(json_stats_t) / sizeof(unsigned long long); i++) {
+        dest[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
 
-    return ret;
+    return JSON_STATS_ENABLED;
 }
 
 /**
- * Sets a floating setting at the desired key
- * @param obj Object in which set the setting
- * @param key Key path at which set the setting (ex: object.object.setting)
- * @param separator Separator of keys in key path
- * @param value Value to set in the setting
- * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ * Sets a callback receiving every parse, dump and lookup miss, with its size and duration. Events are only
+ * sent when the library is built with JSON_STATS. The callback and its context aren't published together:
+ * set them before other threads use the library, not while they parse, dump or look up settings.
+ * @param trace Callback, NULL to stop tracing. It can be called from several threads at once.
+ * @param ctx Context passed to the callback
  */
-int json_set_floating(json_obj_t* obj, const char* key, char separator, long double value) {
-    char** key_array = json_get_key_array(key, separator);
-    size_t key_count = json_key_count(key_array);
-    int ret = json_add_setting(obj, json_create_floating_setting(key_array[key_count - 1], value), key_array, key_count);
-
-    json_free_double_char_array(key_array);
-
-    return ret;
+void json_set_trace(void (*trace)(const json_trace_t* event, void* ctx), void* ctx) {
+    json_trace_ctx = ctx;
+    __atomic_store_n(&json_trace_fn, trace, __ATOMIC_RELEASE);
 }
 
 /**
- * Sets an object setting at the desired key
- * @param obj Object in which set the setting
- * @param key Key path at which set the setting (ex: object.object.setting)
- * @param separator Separator of keys in key path
- * @param value Value to set in the setting
- * @return 0 on failure, 1 on success. Can be a failure when the object in which to set the setting doesn't exist
+ * Sets the allocator of every new document and of the memory that doesn't belong to a document (key paths,
+ * temporary buffers, strings returned by json_dump). Documents keep the allocator they were created with.
+ * It must be called while no memory of the library is alive, before loading any object for example.
+ * @param allocator Allocator, copied by the call, NULL to restore malloc, realloc and free
  */
-int json_set_object(json_obj_t* obj, const char* key, char separator, json_obj_t* value) {
-    char** key_array = json_get_key_array(key, separator);
-    size_t key_count = json_key_count(key_array);
-    int ret = json_add_setting(obj, json_create_object_setting(key_array[key_count - 1], value), key_array, key_count);
-
-    json_free_double_char_array(key_array);
+void json_set_allocator(const json_allocator_t* allocator) {
+    json_allocator_t def = { json_default_malloc, json_default_realloc, json_default_free, NULL };
 
-    return ret;
-}
\ No newline at end of file
+    json_global_allocator = allocator != NULL ? *allocator : def;
+}
@@ -2,6 +2,17 @@
 #define LIBJSON_JSON_H
 
 #include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Declares the binding of a structure field to a setting, for json_bind and json_unbind
+ * @param structure Type of the structure
+ * @param field Name of the field in the structure
+ * @param path Key path of the setting (ex: "object.setting")
+ * @param type Type of the setting (enum json_setting_type_e)
+ */
+#define JSON_BINDING(structure, field, path, type) \
+    { (path), (type), offsetof(structure, field), sizeof(((structure*)0)->field) }
 
 enum json_setting_type_e {
     Boolean,
@@ -11,17 +22,44 @@ enum json_setting_type_e {
     Object,
 };
 
+enum json_trace_type_e {
+    TraceParse,
+    TraceDump,
+    TraceLookupMiss,
+};
+
 typedef struct json_obj_s json_obj_t;
 typedef struct json_setting_s json_setting_t;
+typedef struct json_frozen_s json_frozen_t;
+typedef struct json_doc_s json_doc_t;
+typedef struct json_binding_s json_binding_t;
+typedef struct json_watch_s json_watch_t;
+typedef struct json_stats_s json_stats_t;
+typedef struct json_trace_s json_trace_t;
+typedef struct json_allocator_s json_allocator_t;
+typedef struct json_format_s json_format_t;
+typedef struct json_extract_s json_extract_t;
+typedef struct json_query_s json_query_t;
+typedef struct json_saver_s json_saver_t;
+typedef struct json_saver_options_s json_saver_options_t;
 
 struct json_obj_s {
     json_setting_t** settings;
     size_t settings_count;
+    json_frozen_t* frozen;
+    json_doc_t* doc;
+    unsigned long long hash;
+    unsigned long long hash_generation;
+    unsigned long long hash128[2];
+    unsigned long long hash128_generation;
+    int hash_observed;
+    size_t refcount;
 };
 
 struct json_setting_s {
     char* name;
     enum json_setting_type_e type;
+    unsigned int string_cap;
 
     union {
         int bool_type;
@@ -32,8 +70,92 @@ struct json_setting_s {
     };
 };
 
+/**
+ * Value found by json_extract, text and len span it in the extracted text
+ */
+struct json_extract_s {
+    enum json_setting_type_e type;
+    const char* text;
+    size_t len;
+
+    union {
+        int bool_type;
+        long long long_type;
+        long double double_type;
+    };
+};
+
+/**
+ * Options of json_saver_start, zero for defaults (no rate limiting, no fsync, compact output)
+ */
+struct json_saver_options_s {
+    unsigned int min_interval_ms;
+    int sync;
+    const json_format_t* format;
+    void (*on_saved)(unsigned long long ticket, int success, void* ctx);
+    void (*lock)(void* ctx);
+    void (*unlock)(void* ctx);
+    void* ctx;
+};
+
+struct json_binding_s {
+    const char* path;
+    enum json_setting_type_e type;
+    size_t offset;
+    size_t size;
+};
+
+/**
+ * Counters collected when the library is built with JSON_STATS (cmake -DLIBJSON_STATS=ON)
+ */
+struct json_stats_s {
+    unsigned long long allocations;
+    unsigned long long allocated_bytes;
+    unsigned long long frees;
+    unsigned long long live_bytes;
+    unsigned long long parse_count;
+    unsigned long long parse_bytes;
+    unsigned long long parse_ns;
+    unsigned long long dump_count;
+    unsigned long long dump_bytes;
+    unsigned long long dump_ns;
+    unsigned long long lookups;
+    unsigned long long lookup_depth;
+    unsigned long long lookup_misses;
+};
+
+/**
+ * Formatting options of json_dump_formatted and json_dump_file
+ */
+struct json_format_s {
+    unsigned int indent;
+    char indent_char;
+    int sort_keys;
+};
+
+/**
+ * Memory functions used by the library, ctx is passed to each of them
+ */
+struct json_allocator_s {
+    void* (*malloc)(size_t size, void* ctx);
+    void* (*realloc)(void* ptr, size_t size, void* ctx);
+    void (*free)(void* ptr, void* ctx);
+    void* ctx;
+};
+
+struct json_trace_s {
+    enum json_trace_type_e type;
+    size_t bytes;
+    unsigned long long ns;
+    const char* key;
+};
+
 json_obj_t* json_from_file(const char *path);
+size_t json_from_files(const char* const* paths, size_t count, json_obj_t** objs);
 json_obj_t* json_from_string(const char* str);
+json_obj_t* json_from_string_allocator(const char* str, const json_allocator_t* allocator);
+json_obj_t* json_from_string_parallel(const char* str, unsigned int threads);
+int json_extract(const char* text, size_t len, const char* key, char separator, json_extract_t* out);
 
 char* json_get_string(json_obj_t* obj, const char* str, char separator);
 int json_get_bool(json_obj_t* obj, const char* str, char separator);
@@ -47,12 +169,58 @@ int json_set_integer(json_obj_t* obj, const char* key, char separator, long long
 int json_set_floating(json_obj_t* obj, const char* key, char separator, long double value);
 int json_set_object(json_obj_t* obj, const char* key, char separator, json_obj_t* value);
 
+size_t json_bind(json_obj_t* obj, const json_binding_t* bindings, size_t count, char separator, void* dest);
+size_t json_bind_string(const char* str, const json_binding_t* bindings, size_t count, char separator, void* dest);
+size_t json_unbind(json_obj_t* obj, const json_binding_t* bindings, size_t count, char separator, const void* src);
+
 int json_remove_setting(json_obj_t* obj, const char* key, char separator);
 
+json_obj_t* json_with_string(json_obj_t* obj, const char* key, char separator, const char* value);
+json_obj_t* json_with_bool(json_obj_t* obj, const char* key, char separator, int value);
+json_obj_t* json_with_integer(json_obj_t* obj, const char* key, char separator, long long value);
+json_obj_t* json_with_floating(json_obj_t* obj, const char* key, char separator, long double value);
+json_obj_t* json_with_object(json_obj_t* obj, const char* key, char separator, json_obj_t* value);
+json_obj_t* json_without(json_obj_t* obj, const char* key, char separator);
+json_obj_t* json_clone(json_obj_t* obj);
+
+int json_merge_patch(json_obj_t* target, json_obj_t* patch);
+char** json_diff(json_obj_t* a, json_obj_t* b, char separator);
+void json_diff_free(char** diff);
+unsigned long long json_hash(json_obj_t* obj);
+void json_hash128(json_obj_t* obj, unsigned long long hash[2]);
+
+json_query_t* json_query_compile(const char* query);
+size_t json_query_run(const json_query_t* query, json_obj_t* obj, int (*on_match)(json_setting_t* setting, void* ctx), void* ctx);
+void json_query_free(json_query_t* query);
+
+int json_freeze(json_obj_t* obj);
+
 void json_free(json_obj_t* obj);
 int json_save(json_obj_t* obj, const char* path);
+int json_save_parallel(json_obj_t* obj, const char* path, unsigned int threads);
+
+json_saver_t* json_saver_start(json_obj_t* obj, const char* path, const json_saver_options_t* options);
+unsigned long long json_saver_mark_dirty(json_saver_t* saver);
+int json_saver_wait(json_saver_t* saver, unsigned long long ticket);
+int json_saver_stop(json_saver_t* saver);
+
+json_watch_t* json_watch(const char* path, unsigned int debounce_ms, void (*on_reload)(json_obj_t* obj, void* ctx),
+                         void (*on_error)(const char* message, void* ctx), void* ctx);
+json_obj_t* json_watch_acquire(json_watch_t* watch);
+void json_watch_release(json_watch_t* watch, json_obj_t* obj);
+void json_watch_stop(json_watch_t* watch);
 
 char* json_dump(json_obj_t* obj, int format);
+char* json_dump_formatted(json_obj_t* obj, const json_format_t* format);
+int json_dump_file(json_obj_t* obj, FILE* stream, const json_format_t* format);
+char* json_dump_parallel(json_obj_t* obj, unsigned int threads);
+size_t json_msgpack_encode(json_obj_t* obj, char** data, size_t* cap);
+json_obj_t* json_msgpack_decode(const char* data, size_t len);
 void json_print(json_obj_t* obj, int format);
+void json_free_string(char* str);
+
+int json_get_stats(json_obj_t* obj, json_stats_t* stats);
+void json_set_trace(void (*trace)(const json_trace_t* event, void* ctx), void* ctx);
+void json_set_allocator(const json_allocator_t* allocator);
 
 #endif //LIBJSON_JSON_H
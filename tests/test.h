@@ -0,0 +1,23 @@
+#ifndef LIBJSON_TEST_H
+#define LIBJSON_TEST_H
+
+#include <stdio.h>
+
+static int test_failures = 0;
+
+/**
+ * Records a failure, with its location, when a condition doesn't hold. The test goes on to report every failure.
+ */
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+/**
+ * Exit status of a test, non zero if a check failed
+ */
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
+
+#endif //LIBJSON_TEST_H
@@ -0,0 +1,128 @@
+#include "json.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAGIC 0x6a736f6eu
+
+/**
+ * Allocations made through a counting allocator. Blocks start with a header holding a magic number, so
+ * memory that didn't come from the allocator is detected when it's given back.
+ */
+typedef struct counter_s {
+    long live;
+    long allocations;
+    long foreign;
+    long fail_at;
+} counter_t;
+
+typedef struct header_s {
+    unsigned int magic;
+    unsigned int pad[3];
+} header_t;
+
+static void* counting_malloc(size_t size, void* ctx) {
+    counter_t* counter = ctx;
+
+    if (++counter->allocations == counter->fail_at) {
+        return NULL;
+    }
+
+    header_t* header = malloc(sizeof(header_t) + size);
+    header->magic = MAGIC;
+    counter->live++;
+    return header + 1;
+}
+
+static void* counting_realloc(void* ptr, size_t size, void* ctx) {
+    counter_t* counter = ctx;
+    header_t* header = (header_t*)ptr - 1;
+
+    if (header->magic != MAGIC) {
+        counter->foreign++;
+        return NULL;
+    }
+
+    counter->allocations++;
+    header = realloc(header, sizeof(header_t) + size);
+    return header != NULL ? header + 1 : NULL;
+}
+
+static void counting_free(void* ptr, void* ctx) {
+    counter_t* counter = ctx;
+    header_t* header = (header_t*)ptr - 1;
+
+    if (ptr == NULL) {
+        return;
+    }
+    if (header->magic != MAGIC) {
+        counter->foreign++;
+        return;
+    }
+
+    header->magic = 0;
+    counter->live--;
+    free(header);
+}
+
+int main(void) {
+    const char* text = "{\"name\":\"libjson\",\"server\":{\"host\":\"localhost\",\"port\":8080},\"tags\":{}}";
+    counter_t global = { 0 };
+    counter_t local = { 0 };
+    json_allocator_t global_allocator = { counting_malloc, counting_realloc, counting_free, &global };
+    json_allocator_t local_allocator = { counting_malloc, counting_realloc, counting_free, &local };
+
+    /* Every allocation and free of a document goes through its allocator */
+    json_obj_t* json = json_from_string_allocator(text, &local_allocator);
+    CHECK(json != NULL && json_get_integer(json, "server.port", '.') == 8080);
+    CHECK(local.live > 0);
+
+    CHECK(json_set_string(json, "server.host", '.', "a longer host name than before") == 1);
+    CHECK(json_set_integer(json, "tags.count", '.', 3) == 1);
+    CHECK(json_remove_setting(json, "name", '.') == 1);
+
+    /* Copies and versions keep the allocator of the original */
+    json_obj_t* clone = json_clone(json);
+    json_obj_t* version = json_with_integer(json, "server.port", '.', 8443);
+    CHECK(clone != NULL && version != NULL);
+    json_free(clone);
+    json_free(version);
+
+    json_free(json);
+    CHECK(local.live == 0);
+    CHECK(local.foreign == 0);
+
+    /* The global allocator also gets the memory that doesn't belong to a document */
+    json_set_allocator(&global_allocator);
+
+    json = json_from_string(text);
+    CHECK(json != NULL);
+    char* dump = json_dump(json, 1);
+    CHECK(dump != NULL && global.live > 0);
+    CHECK(json_get_string(json, "server.host", '.') != NULL);
+    json_free_string(dump);
+    json_free(json);
+    CHECK(global.live == 0);
+    CHECK(global.foreign == 0);
+
+    /* A failing allocator makes parsing fail, without leaking what was already allocated */
+    for (long i = 1; i <= 2; i++) {
+        global.allocations = 0;
+        global.fail_at = i;
+        CHECK(json_from_string(text) == NULL);
+        CHECK(global.live == 0);
+
+        local.allocations = 0;
+        local.fail_at = i;
+        CHECK(json_from_string_allocator(text, &local_allocator) == NULL);
+        CHECK(local.live == 0);
+    }
+    global.fail_at = 0;
+
+    json_set_allocator(NULL);
+    CHECK(global.live == 0 && local.live == 0);
+    CHECK(global.foreign == 0 && local.foreign == 0);
+
+    return TEST_RESULT();
+}
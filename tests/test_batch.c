@@ -0,0 +1,68 @@
+#include "json.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FILES 150
+
+static void write_file(const char* path, const char* content) {
+    FILE* file = fopen(path, "w");
+
+    fputs(content, file);
+    fclose(file);
+}
+
+int main(void) {
+    char dir[] = "/tmp/libjson_batch_XXXXXX";
+    char paths[FILES][64];
+    const char* list[FILES];
+    json_obj_t* objs[FILES];
+
+    CHECK(mkdtemp(dir) != NULL);
+
+    /* More files than the reads kept in flight, with a missing, an empty, an invalid and a large file */
+    for (int i = 0; i < FILES; i++) {
+        char content[64];
+
+        snprintf(paths[i], sizeof(paths[i]), "%s/%d.json", dir, i);
+        snprintf(content, sizeof(content), "{\"index\":%d}", i);
+        list[i] = paths[i];
+
+        if (i == 3) {
+            continue;
+        }
+        write_file(paths[i], i == 5 ? "" : i == 7 ? "{\"broken\":" : content);
+    }
+
+    FILE* large = fopen(paths[9], "w");
+    fputs("{\"index\":9", large);
+    for (int i = 0; i < 100000; i++) {
+        fprintf(large, ",\"key%d\":\"value %d\"", i, i);
+    }
+    fputs("}", large);
+    fclose(large);
+
+    CHECK(json_from_files(list, FILES, objs) == FILES - 2);
+    CHECK(objs[3] == NULL);
+    CHECK(objs[5] != NULL && objs[5]->settings_count == 0);
+    CHECK(objs[7] == NULL);
+    CHECK(objs[9] != NULL && objs[9]->settings_count == 100001);
+    CHECK(objs[9] != NULL && strcmp(json_get_string(objs[9], "key99999", '.'), "value 99999") == 0);
+
+    for (int i = 0; i < FILES; i++) {
+        if (i != 3 && i != 5 && i != 7) {
+            CHECK(objs[i] != NULL && json_get_integer(objs[i], "index", '.') == i);
+        }
+        if (objs[i] != NULL) {
+            json_free(objs[i]);
+        }
+        remove(paths[i]);
+    }
+
+    CHECK(json_from_files(list, 0, objs) == 0);
+
+    rmdir(dir);
+    return TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+typedef struct {
+    char host[8];
+    short port;
+    long long big;
+    float ratio;
+    long double precise;
+    int debug;
+    json_obj_t* tls;
+    char missing[4];
+} config_t;
+
+typedef struct {
+    char odd[3];
+    long double value;
+} odd_t;
+
+static const json_binding_t bindings[] = {
+    JSON_BINDING(config_t, host, "server.host", String),
+    JSON_BINDING(config_t, port, "server.port", Integer),
+    JSON_BINDING(config_t, big, "big", Integer),
+    JSON_BINDING(config_t, ratio, "ratio", Floating),
+    JSON_BINDING(config_t, precise, "port_as_float", Floating),
+    JSON_BINDING(config_t, debug, "debug", Boolean),
+    JSON_BINDING(config_t, tls, "server.tls", Object),
+    JSON_BINDING(config_t, missing, "nowhere", String),
+};
+
+static const char* text = "{\"server\":{\"host\":\"local\\u0068ost\",\"port\":8080,\"tls\":{\"on\":true}},"
+                          "\"big\":9000000000,\"ratio\":0.25,\"port_as_float\":3,\"debug\":true}";
+
+int main(void) {
+    json_obj_t* json = json_from_string(text);
+    config_t config;
+
+    memset(&config, 0, sizeof(config));
+    strcpy(config.missing, "def");
+    CHECK(json != NULL);
+
+    /* Every bound field but the missing one, strings are truncated to the array */
+    CHECK(json_bind(json, bindings, 8, '.', &config) == 7);
+    CHECK(strcmp(config.host, "localho") == 0);
+    CHECK(config.port == 8080);
+    CHECK(config.big == 9000000000LL);
+    CHECK(config.ratio == 0.25f);
+    CHECK(config.precise == 3.0L);
+    CHECK(config.debug == 1);
+    CHECK(config.tls == json_get_object(json, "server.tls", '.'));
+    CHECK(strcmp(config.missing, "def") == 0);
+
+    /* Straight from the text: same fields except the object one */
+    config_t from_text;
+    memset(&from_text, 0, sizeof(from_text));
+    CHECK(json_bind_string(text, bindings, 8, '.', &from_text) == 6);
+    CHECK(strcmp(from_text.host, "localho") == 0);
+    CHECK(from_text.port == 8080);
+    CHECK(from_text.big == 9000000000LL);
+    CHECK(from_text.ratio == 0.25f);
+    CHECK(from_text.precise == 3.0L);
+    CHECK(from_text.debug == 1);
+    CHECK(from_text.tls == NULL);
+
+    /* Bindings sharing parents, keys in string values, duplicated keys and paths through other values */
+    const char* tricky = "{\"decoy\":\"\\\"big\\\":1\",\"server\":{\"tls\":{\"on\":1},\"port\":81,\"host\":\"a\"},"
+                         "\"big\":2,\"server\":{\"port\":82},\"big\":3,\"debug\":{\"x\":1},\"ratio\":\"no\"}";
+    memset(&from_text, 0, sizeof(from_text));
+    CHECK(json_bind_string(tricky, bindings, 8, '.', &from_text) == 3);
+    CHECK(strcmp(from_text.host, "a") == 0);
+    CHECK(from_text.port == 81);
+    CHECK(from_text.big == 2);
+    CHECK(from_text.debug == 0 && from_text.ratio == 0.0f);
+    CHECK(json_bind_string("{\"server\":1,\"big\":4}", bindings, 8, '.', &from_text) == 1);
+    CHECK(from_text.big == 4 && from_text.port == 81);
+    CHECK(json_bind_string("[1]", bindings, 8, '.', &from_text) == 0);
+
+    /* Type mismatches leave the field untouched */
+    json_binding_t mismatch = JSON_BINDING(config_t, port, "server.host", Integer);
+    config.port = 1;
+    CHECK(json_bind(json, &mismatch, 1, '.', &config) == 0);
+    CHECK(json_bind_string(text, &mismatch, 1, '.', &config) == 0);
+    CHECK(config.port == 1);
+
+    /* Writing back */
+    config.port = 9090;
+    config.debug = 0;
+    config.ratio = 0.5f;
+    strcpy(config.host, "remote");
+    CHECK(json_unbind(json, bindings, 8, '.', &config) == 7);
+    CHECK(strcmp(json_get_string(json, "nowhere", '.'), "def") == 0);
+    CHECK(json_get_integer(json, "server.port", '.') == 9090);
+    CHECK(json_get_bool(json, "debug", '.') == 0);
+    CHECK(json_get_floating(json, "ratio", '.') == 0.5L);
+    CHECK(strcmp(json_get_string(json, "server.host", '.'), "remote") == 0);
+
+    /* Unsupported field sizes are rejected both ways instead of being read or written past the field */
+    odd_t odd = { "ab", 0 };
+    json_binding_t odd_int = { "server.port", Integer, offsetof(odd_t, odd), 3 };
+    json_binding_t odd_float = { "ratio", Floating, offsetof(odd_t, odd), 3 };
+    CHECK(json_bind(json, &odd_int, 1, '.', &odd) == 0);
+    CHECK(json_bind(json, &odd_float, 1, '.', &odd) == 0);
+    CHECK(json_unbind(json, &odd_int, 1, '.', &odd) == 0);
+    CHECK(json_unbind(json, &odd_float, 1, '.', &odd) == 0);
+    CHECK(json_get_integer(json, "server.port", '.') == 9090);
+    CHECK(strcmp(odd.odd, "ab") == 0);
+
+    json_free(json);
+    return TEST_RESULT();
+}
@@ -0,0 +1,108 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+/**
+ * Checks whether a path is listed in a diff
+ */
+static int listed(char** diff, const char* path) {
+    for (size_t i = 0; diff[i] != NULL; i++) {
+        if (strcmp(diff[i], path) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static size_t length(char** diff) {
+    size_t count = 0;
+
+    while (diff[count] != NULL) {
+        count++;
+    }
+
+    return count;
+}
+
+int main(void) {
+    json_obj_t* a = json_from_string("{\"name\":\"x\",\"port\":1,\"server\":{\"host\":\"h\",\"tls\":{\"on\":true}},"
+                                     "\"gone\":false,\"same\":{\"k\":1.5}}");
+    json_obj_t* b = json_from_string("{\"same\":{\"k\":1.5},\"name\":\"x\",\"port\":\"1\","
+                                     "\"server\":{\"host\":\"h\",\"tls\":{\"on\":false}},\"new\":null}");
+    char** diff = json_diff(a, b, '.');
+
+    /* Changed value type, changed nested value, removed and added settings; key order doesn't matter */
+    CHECK(diff != NULL);
+    CHECK(length(diff) == 4);
+    CHECK(listed(diff, "port"));
+    CHECK(listed(diff, "server.tls.on"));
+    CHECK(listed(diff, "gone"));
+    CHECK(listed(diff, "new"));
+    json_diff_free(diff);
+
+    /* The separator is used in the returned paths */
+    diff = json_diff(a, b, '/');
+    CHECK(listed(diff, "server/tls/on"));
+    json_diff_free(diff);
+
+    /* Equal objects give an empty diff */
+    diff = json_diff(a, a, '.');
+    CHECK(diff != NULL && diff[0] == NULL);
+    json_diff_free(diff);
+
+    /* Changes made after a first diff are seen: cached hashes are invalidated by setters */
+    CHECK(json_set_bool(b, "server.tls.on", '.', 1) == 1);
+    CHECK(json_set_integer(b, "port", '.', 1) == 1);
+    CHECK(json_set_bool(b, "gone", '.', 0) == 1);
+    CHECK(json_remove_setting(b, "new", '.') == 1);
+    diff = json_diff(a, b, '.');
+    CHECK(diff != NULL && diff[0] == NULL);
+    json_diff_free(diff);
+
+    /* Sub-objects of another document changed through their own handle */
+    json_obj_t* child = json_from_string("{\"k\":1}");
+    json_obj_t* copy = json_from_string("{\"k\":1}");
+    CHECK(json_set_object(a, "child", '.', child) == 1);
+    CHECK(json_set_object(b, "child", '.', copy) == 1);
+    diff = json_diff(a, b, '.');
+    CHECK(diff != NULL && diff[0] == NULL);
+    json_diff_free(diff);
+
+    CHECK(json_set_integer(child, "k", '.', 2) == 1);
+    diff = json_diff(a, b, '.');
+    CHECK(diff != NULL && length(diff) == 1 && listed(diff, "child.k"));
+    json_diff_free(diff);
+
+    /* An edit only invalidates the cached hashes of the objects on its path */
+    json_obj_t* tree = json_from_string("{\"left\":{\"x\":{\"y\":1}},\"right\":{\"z\":2},\"n\":3}");
+    json_obj_t* left = json_get_object(tree, "left", '.');
+    json_obj_t* x = json_get_object(tree, "left.x", '.');
+    json_obj_t* right = json_get_object(tree, "right", '.');
+    unsigned long long before = json_hash(tree);
+    unsigned long long right_hash = json_hash(right);
+
+    unsigned long long generation = right->hash_generation;
+
+    CHECK(generation != 0 && x->hash_generation == generation);
+    CHECK(json_set_integer(tree, "left.w", '.', 4) == 1);
+    CHECK(tree->hash_generation == 0 && left->hash_generation == 0);
+    CHECK(right->hash_generation == generation && x->hash_generation == generation);
+    CHECK(json_hash(right) == right_hash);
+    CHECK(json_hash(tree) != before);
+    CHECK(json_remove_setting(tree, "left.w", '.') == 1);
+    CHECK(json_hash(tree) == before);
+    CHECK(right->hash_generation == generation);
+
+    /* Edits through a sub-object still reach the hashes of its parents */
+    CHECK(json_set_integer(x, "y", '.', 5) == 1);
+    CHECK(json_hash(tree) != before);
+    CHECK(json_set_integer(x, "y", '.', 1) == 1);
+    CHECK(json_hash(tree) == before);
+    json_free(tree);
+
+    json_free(a);
+    json_free(b);
+    return TEST_RESULT();
+}
@@ -0,0 +1,139 @@
+#include "json.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Dumps an object with options and compares the result with the expected text
+ */
+static int dumps_as(json_obj_t* obj, const json_format_t* format, const char* expected) {
+    char* dump = json_dump_formatted(obj, format);
+    int equal = dump != NULL && strcmp(dump, expected) == 0;
+
+    json_free_string(dump);
+    return equal;
+}
+
+/**
+ * Streams an object to a temporary file and compares the file with json_dump_formatted, byte for byte
+ */
+static int streams_as_dump(json_obj_t* obj, const json_format_t* format) {
+    FILE* stream = tmpfile();
+    char* dump = json_dump_formatted(obj, format);
+    size_t len = strlen(dump);
+    char* content = malloc(len + 2);
+    int equal = 0;
+
+    if (stream != NULL && json_dump_file(obj, stream, format) == 1) {
+        rewind(stream);
+        equal = fread(content, 1, len + 1, stream) == len && memcmp(content, dump, len) == 0;
+    }
+
+    if (stream != NULL) {
+        fclose(stream);
+    }
+    free(content);
+    json_free_string(dump);
+    return equal;
+}
+
+int main(void) {
+    json_obj_t* json = json_from_string("{\"name\":\"libjson\",\"port\":8080,\"ratio\":0.5,\"debug\":true,\"none\":null,"
+                                        "\"server\":{\"host\":\"localhost\",\"tls\":{\"enabled\":false}}}");
+
+    /* The formatted output of json_dump is the one of the original implementation */
+    char* dump = json_dump(json, 1);
+    CHECK(strcmp(dump, "{\n"
+                       "\t\"name\": \"libjson\",\n"
+                       "\t\"port\": 8080,\n"
+                       "\t\"ratio\": 0.500000,\n"
+                       "\t\"debug\": true,\n"
+                       "\t\"none\": null,\n"
+                       "\t\"server\": {\n"
+                       "\t\t\"host\": \"localhost\",\n"
+                       "\t\t\"tls\": {\n"
+                       "\t\t\t\"enabled\": false\n"
+                       "\t\t}\n"
+                       "\t}\n"
+                       "}") == 0);
+    json_free_string(dump);
+
+    dump = json_dump(json, 0);
+    CHECK(strcmp(dump, "{\"name\":\"libjson\",\"port\":8080,\"ratio\":0.500000,\"debug\":true,\"none\":null,"
+                       "\"server\":{\"host\":\"localhost\",\"tls\":{\"enabled\":false}}}") == 0);
+    json_free_string(dump);
+
+    /* Compact mode, indent width and character, sorted keys */
+    CHECK(dumps_as(json, NULL, "{\"name\":\"libjson\",\"port\":8080,\"ratio\":0.500000,\"debug\":true,\"none\":null,"
+                               "\"server\":{\"host\":\"localhost\",\"tls\":{\"enabled\":false}}}"));
+
+    json_format_t two_spaces = { .indent = 2, .indent_char = ' ', .sort_keys = 0 };
+    CHECK(dumps_as(json, &two_spaces, "{\n"
+                                      "  \"name\": \"libjson\",\n"
+                                      "  \"port\": 8080,\n"
+                                      "  \"ratio\": 0.500000,\n"
+                                      "  \"debug\": true,\n"
+                                      "  \"none\": null,\n"
+                                      "  \"server\": {\n"
+                                      "    \"host\": \"localhost\",\n"
+                                      "    \"tls\": {\n"
+                                      "      \"enabled\": false\n"
+                                      "    }\n"
+                                      "  }\n"
+                                      "}"));
+
+    json_format_t sorted = { .indent = 4, .indent_char = ' ', .sort_keys = 1 };
+    CHECK(dumps_as(json, &sorted, "{\n"
+                                  "    \"debug\": true,\n"
+                                  "    \"name\": \"libjson\",\n"
+                                  "    \"none\": null,\n"
+                                  "    \"port\": 8080,\n"
+                                  "    \"ratio\": 0.500000,\n"
+                                  "    \"server\": {\n"
+                                  "        \"host\": \"localhost\",\n"
+                                  "        \"tls\": {\n"
+                                  "            \"enabled\": false\n"
+                                  "        }\n"
+                                  "    }\n"
+                                  "}"));
+
+    json_format_t no_indent = { .indent = 0, .indent_char = ' ', .sort_keys = 0 };
+    CHECK(dumps_as(json, &no_indent, "{\n"
+                                     "\"name\": \"libjson\",\n"
+                                     "\"port\": 8080,\n"
+                                     "\"ratio\": 0.500000,\n"
+                                     "\"debug\": true,\n"
+                                     "\"none\": null,\n"
+                                     "\"server\": {\n"
+                                     "\"host\": \"localhost\",\n"
+                                     "\"tls\": {\n"
+                                     "\"enabled\": false\n"
+                                     "}\n"
+                                     "}\n"
+                                     "}"));
+
+    /* Empty objects stay on one line */
+    json_obj_t* empty = json_from_string("{\"e\":{},\"a\":{\"b\":{}}}");
+    CHECK(dumps_as(empty, &sorted, "{\n    \"a\": {\n        \"b\": {}\n    },\n    \"e\": {}\n}"));
+    CHECK(dumps_as(empty, NULL, "{\"e\":{},\"a\":{\"b\":{}}}"));
+    json_free(empty);
+
+    /* Streaming gives the same bytes, also for outputs bigger than the stream buffer */
+    CHECK(streams_as_dump(json, NULL));
+    CHECK(streams_as_dump(json, &two_spaces));
+    CHECK(streams_as_dump(json, &sorted));
+
+    for (int i = 0; i < 3000; i++) {
+        char key[32];
+
+        snprintf(key, sizeof(key), "server.key%05d", i);
+        CHECK(json_set_string(json, key, '.', "a value long enough to fill the stream buffer quickly"));
+    }
+    CHECK(streams_as_dump(json, NULL));
+    CHECK(streams_as_dump(json, &two_spaces));
+    CHECK(streams_as_dump(json, &sorted));
+
+    json_free(json);
+    return TEST_RESULT();
+}
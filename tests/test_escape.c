@@ -0,0 +1,114 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+/**
+ * Parses a JSON text, dumps it back without indentation and compares the dump with the expected text
+ */
+static int dumps_as(const char* text, const char* expected) {
+    json_obj_t* obj = json_from_string(text);
+
+    if (obj == NULL) {
+        return 0;
+    }
+
+    char* dump = json_dump(obj, 0);
+    int equal = dump != NULL && strcmp(dump, expected) == 0;
+
+    json_free_string(dump);
+    json_free(obj);
+    return equal;
+}
+
+/**
+ * Parses a JSON text and compares the decoded value of a string setting
+ */
+static int decodes_as(const char* text, const char* key, const char* expected) {
+    json_obj_t* obj = json_from_string(text);
+
+    if (obj == NULL) {
+        return 0;
+    }
+
+    char* value = json_get_string(obj, key, '.');
+    int equal = value != NULL && strcmp(value, expected) == 0;
+
+    json_free(obj);
+    return equal;
+}
+
+/**
+ * Parses a JSON text, expecting it to be rejected
+ */
+static int rejected(const char* text) {
+    json_obj_t* obj = json_from_string(text);
+
+    if (obj != NULL) {
+        json_free(obj);
+        return 0;
+    }
+
+    return 1;
+}
+
+int main(void) {
+    char text[256];
+    char expected[256];
+
+    /* Escapes are decoded when parsing and encoded again when dumping, UTF-8 is kept as is */
+    CHECK(decodes_as("{\"s\":\"a\\\"b\\\\c\\nd\\u00e9\"}", "s", "a\"b\\c\nd\xc3\xa9"));
+    CHECK(dumps_as("{\"s\":\"a\\\"b\\\\c\\nd\\u00e9\"}", "{\"s\":\"a\\\"b\\\\c\\nd\xc3\xa9\"}"));
+    CHECK(dumps_as("{\"s\":\"caf\xc3\xa9 \\ud83d\\ude00\"}", "{\"s\":\"caf\xc3\xa9 \xf0\x9f\x98\x80\"}"));
+    CHECK(dumps_as("{\"s\":\"\\t\\r\\b\\f\\/\"}", "{\"s\":\"\\t\\r\\b\\f/\"}"));
+    CHECK(dumps_as("{\"\\u00e9t\\u00e9\":1}", "{\"\xc3\xa9t\xc3\xa9\":1}"));
+
+    /* Strings ending with an escaped backslash end at the following quote */
+    CHECK(decodes_as("{\"s\":\"ends with \\\\\",\"t\":\"x\"}", "s", "ends with \\"));
+    CHECK(decodes_as("{\"s\":\"ends with \\\\\",\"t\":\"x\"}", "t", "x"));
+    CHECK(decodes_as("{\"s\":\"\\\\\\\\\",\"t\":{\"u\":\"\\\\\"}}", "t.u", "\\"));
+    CHECK(dumps_as("{\"s\":\"\\\\\",\"t\":{\"u\":\"\\\\\\\"\"}}", "{\"s\":\"\\\\\",\"t\":{\"u\":\"\\\\\\\"\"}}"));
+
+    /* Invalid UTF-8, NUL characters, lone surrogates, raw control characters and unknown escapes */
+    CHECK(rejected("{\"s\":\"bad \xff\"}"));
+    CHECK(rejected("{\"s\":\"overlong \xc0\x80\"}"));
+    CHECK(rejected("{\"s\":\"truncated \xc3\"}"));
+    CHECK(rejected("{\"s\":\"surrogate \xed\xa0\x80\"}"));
+    CHECK(rejected("{\"s\":\"nul \\u0000 x\"}"));
+    CHECK(rejected("{\"s\":\"\\ud83d\"}"));
+    CHECK(rejected("{\"s\":\"\\ude00\"}"));
+    CHECK(rejected("{\"s\":\"tab\tin\"}"));
+    CHECK(rejected("{\"s\":\"\\x41\"}"));
+    CHECK(rejected("{\"s\":\"\\u00g9\"}"));
+    CHECK(rejected("{\"k\xff\":1}"));
+
+    /* Long strings go through the 16 bytes block scans, the special character is moved across blocks */
+    for (size_t at = 0; at < 48; at++) {
+        memset(text, 0, sizeof(text));
+        memset(expected, 0, sizeof(expected));
+        strcpy(text, "{\"s\":\"");
+        strcpy(expected, text);
+        memset(text + 6, 'a', at);
+        memset(expected + 6, 'a', at);
+
+        strcat(text, "\\\"\\u00e9\\\\");
+        strcat(expected, "\\\"\xc3\xa9\\\\");
+        memset(text + strlen(text), 'b', 40);
+        memset(expected + strlen(expected), 'b', 40);
+        strcat(text, "\\\\\",\"t\":\"x\"}");
+        strcat(expected, "\\\\\",\"t\":\"x\"}");
+        CHECK(dumps_as(text, expected));
+
+        strcpy(text + 6 + at, "\xff");
+        memset(text + 7 + at, 'c', 40);
+        strcpy(text + 47 + at, "\"}");
+        CHECK(rejected(text));
+
+        strcpy(text + 6 + at, "\x01");
+        memset(text + 7 + at, 'c', 40);
+        strcpy(text + 47 + at, "\"}");
+        CHECK(rejected(text));
+    }
+
+    return TEST_RESULT();
+}
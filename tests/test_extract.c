@@ -0,0 +1,76 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+/**
+ * Extracts a key path from a NUL-terminated text
+ */
+static int extract(const char* text, const char* key, json_extract_t* out) {
+    return json_extract(text, strlen(text), key, '.', out);
+}
+
+/**
+ * Checks whether the span of an extracted value is exactly some text
+ */
+static int spans(const json_extract_t* value, const char* expected) {
+    return value->len == strlen(expected) && memcmp(value->text, expected, value->len) == 0;
+}
+
+int main(void) {
+    const char* text = "{ \"name\" : \"libjson\", \"port\": 8080, \"ratio\": -2.5e1, \"debug\": true,\n"
+                       "  \"none\": null, \"server\": { \"host\": \"localhost\", \"tls\": {\"on\": false} },\n"
+                       "  \"empty\": {} }";
+    json_extract_t value;
+
+    /* Scalars of every type, at the top level and nested */
+    CHECK(extract(text, "name", &value) && value.type == String && spans(&value, "libjson"));
+    CHECK(extract(text, "port", &value) && value.type == Integer && value.long_type == 8080);
+    CHECK(extract(text, "ratio", &value) && value.type == Floating && value.double_type == -25.0L);
+    CHECK(extract(text, "debug", &value) && value.type == Boolean && value.bool_type == 1);
+    CHECK(extract(text, "server.host", &value) && value.type == String && spans(&value, "localhost"));
+    CHECK(extract(text, "server.tls.on", &value) && value.type == Boolean && value.bool_type == 0);
+
+    /* Objects and null span their whole value */
+    CHECK(extract(text, "server.tls", &value) && value.type == Object && spans(&value, "{\"on\": false}"));
+    CHECK(extract(text, "server", &value) && value.type == Object &&
+          spans(&value, "{ \"host\": \"localhost\", \"tls\": {\"on\": false} }"));
+    CHECK(extract(text, "empty", &value) && value.type == Object && spans(&value, "{}"));
+    CHECK(extract(text, "none", &value) && value.type == Object && spans(&value, "null"));
+
+    /* Missing keys, and key paths going through values that aren't objects */
+    CHECK(extract(text, "missing", &value) == 0);
+    CHECK(extract(text, "server.missing", &value) == 0);
+    CHECK(extract(text, "server.tls.on.deeper", &value) == 0);
+    CHECK(extract(text, "name.first", &value) == 0);
+    CHECK(extract(text, "none.x", &value) == 0);
+    CHECK(extract(text, "serv", &value) == 0);
+
+    /* Keys appearing in string values or in skipped objects don't match */
+    const char* decoy = "{\"a\":\"\\\"target\\\":1\",\"b\":{\"target\":2},\"c\":\"target\",\"target\":3}";
+    CHECK(extract(decoy, "target", &value) && value.type == Integer && value.long_type == 3);
+    CHECK(extract(decoy, "b.target", &value) && value.long_type == 2);
+
+    /* Escaped quotes and backslashes before the match don't end the strings early */
+    const char* escaped = "{\"s\":\"a\\\\\",\"t\":\"x\\\"y\\\\\\\"\",\"k\\\"ey\":{\"v\":\"\\\\\"},\"v\":5}";
+    CHECK(extract(escaped, "v", &value) && value.type == Integer && value.long_type == 5);
+    CHECK(extract(escaped, "t", &value) && value.type == String && spans(&value, "x\\\"y\\\\\\\""));
+    CHECK(extract(escaped, "s", &value) && spans(&value, "a\\\\"));
+
+    /* The type is the one of the text: quoted numbers are strings */
+    CHECK(extract("{\"n\":\"5\",\"m\":5.0}", "n", &value) && value.type == String);
+    CHECK(extract("{\"n\":\"5\",\"m\":5.0}", "m", &value) && value.type == Floating);
+
+    /* The text doesn't need to be NUL-terminated, and invalid text fails */
+    CHECK(json_extract("{\"a\":1}garbage", 7, "a", '.', &value) == 1 && value.long_type == 1);
+    CHECK(json_extract("{\"a\":1,\"b\":2}", 8, "b", '.', &value) == 0);
+    CHECK(extract("{\"a\" 1}", "a", &value) == 0);
+    CHECK(extract("{\"a\":\"unterminated}", "b", &value) == 0);
+    CHECK(extract("[1,2]", "a", &value) == 0);
+    CHECK(extract("", "a", &value) == 0);
+
+    /* Another separator */
+    CHECK(json_extract(text, strlen(text), "server/tls/on", '/', &value) == 1 && value.type == Boolean);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,64 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+int main(void) {
+    json_obj_t* json = json_from_string("{\"name\":\"libjson\",\"port\":8080,\"ratio\":0.5,\"debug\":true,"
+                                        "\"server\":{\"host\":\"localhost\",\"tls\":{\"enabled\":false}}}");
+    char big[8192] = "{";
+
+    CHECK(json != NULL);
+    CHECK(json_freeze(json) == 1);
+    CHECK(json_freeze(json) == 1);
+
+    /* Every key is found through the perfect hash, at every depth */
+    CHECK(strcmp(json_get_string(json, "name", '.'), "libjson") == 0);
+    CHECK(json_get_integer(json, "port", '.') == 8080);
+    CHECK(json_get_floating(json, "ratio", '.') == 0.5L);
+    CHECK(json_get_bool(json, "debug", '.') == 1);
+    CHECK(strcmp(json_get_string(json, "server.host", '.'), "localhost") == 0);
+    CHECK(json_get_bool(json, "server.tls.enabled", '.') == 0);
+    CHECK(json_get_object(json, "server.tls", '.') != NULL);
+
+    /* Missing keys, including keys of the same length as existing ones */
+    CHECK(json_get_object(json, "missing", '.') == NULL);
+    CHECK(json_get_string(json, "nane", '.') == NULL);
+    CHECK(json_get_string(json, "server.hostx", '.') == NULL);
+
+    /* Frozen objects are read-only */
+    CHECK(json_set_integer(json, "port", '.', 1) == 0);
+    CHECK(json_set_string(json, "new", '.', "value") == 0);
+    CHECK(json_remove_setting(json, "name", '.') == 0);
+    CHECK(json_set_bool(json, "server.tls.enabled", '.', 1) == 0);
+    CHECK(json_get_integer(json, "port", '.') == 8080);
+    json_free(json);
+
+    /* Enough keys to need several displacement seeds */
+    for (int i = 0; i < 300; i++) {
+        snprintf(big + strlen(big), sizeof(big) - strlen(big), "%s\"key%d\":%d", i == 0 ? "" : ",", i, i);
+    }
+    strcat(big, "}");
+
+    json = json_from_string(big);
+    CHECK(json != NULL);
+    CHECK(json_freeze(json) == 1);
+
+    for (int i = 0; i < 300; i++) {
+        char key[16];
+
+        snprintf(key, sizeof(key), "key%d", i);
+        CHECK(json_get_integer(json, key, '.') == i);
+    }
+    CHECK(json_get_object(json, "key300", '.') == NULL);
+    json_free(json);
+
+    /* An empty object can be frozen too */
+    json = json_from_string("{}");
+    CHECK(json != NULL);
+    CHECK(json_freeze(json) == 1);
+    CHECK(json_get_object(json, "any", '.') == NULL);
+    json_free(json);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,70 @@
+#include "json.h"
+#include "test.h"
+
+/**
+ * Checks whether both 128 bits hashes of two objects are equal
+ */
+static int equal128(json_obj_t* a, json_obj_t* b) {
+    unsigned long long ha[2];
+    unsigned long long hb[2];
+
+    json_hash128(a, ha);
+    json_hash128(b, hb);
+    return ha[0] == hb[0] && ha[1] == hb[1];
+}
+
+int main(void) {
+    json_obj_t* a = json_from_string("{\"name\":\"x\",\"port\":1,\"server\":{\"host\":\"h\",\"tls\":{\"on\":true}}}");
+    json_obj_t* b = json_from_string("{ \"server\" : { \"tls\" : { \"on\" : true }, \"host\" : \"h\" },\n"
+                                     "  \"port\" : 1, \"name\" : \"x\" }");
+    json_obj_t* c = json_from_string("{\"name\":\"x\",\"port\":1,\"server\":{\"host\":\"h\",\"tls\":{\"on\":false}}}");
+
+    /* Hashes are computed on the first call, not while parsing */
+    CHECK(a->hash_generation == 0 && a->hash128_generation == 0);
+
+    /* Key order and formatting don't matter, values and types do */
+    CHECK(json_hash(a) == json_hash(b));
+    CHECK(equal128(a, b));
+    CHECK(json_hash(a) != json_hash(c));
+    CHECK(equal128(a, c) == 0);
+    CHECK(json_hash(NULL) == 0);
+
+    json_obj_t* d = json_from_string("{\"port\":\"1\"}");
+    json_obj_t* e = json_from_string("{\"port\":1}");
+    CHECK(json_hash(d) != json_hash(e));
+    CHECK(equal128(d, e) == 0);
+    json_free(d);
+    json_free(e);
+
+    /* Nested edits change the hash of the root, undoing them restores it */
+    unsigned long long before = json_hash(a);
+    CHECK(json_set_bool(a, "server.tls.on", '.', 0) == 1);
+    CHECK(json_hash(a) != before);
+    CHECK(json_hash(a) == json_hash(c));
+    CHECK(equal128(a, c));
+    CHECK(json_set_bool(a, "server.tls.on", '.', 1) == 1);
+    CHECK(json_hash(a) == before);
+    CHECK(equal128(a, b));
+
+    json_obj_t* tls = json_get_object(b, "server.tls", '.');
+    CHECK(json_set_integer(tls, "level", '.', 3) == 1);
+    CHECK(json_hash(b) != before);
+    CHECK(equal128(a, b) == 0);
+    CHECK(json_remove_setting(b, "server.tls.level", '.') == 1);
+    CHECK(json_hash(b) == before);
+
+    /* Freezing doesn't change the hashes */
+    unsigned long long hash[2];
+    unsigned long long frozen[2];
+    json_hash128(a, hash);
+    CHECK(json_freeze(a) == 1);
+    CHECK(json_hash(a) == before);
+    json_hash128(a, frozen);
+    CHECK(frozen[0] == hash[0] && frozen[1] == hash[1]);
+    CHECK(equal128(a, b));
+
+    json_free(a);
+    json_free(b);
+    json_free(c);
+    return TEST_RESULT();
+}
@@ -0,0 +1,91 @@
+#include "json.h"
+#include "test.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* Not part of the public API, used to check that lookups compare interned names */
+json_setting_t* json_obj_find(json_obj_t* obj, const char* key, size_t len);
+
+/**
+ * Gets the name pointer of the setting at a key path
+ */
+static const char* name_at(json_obj_t* obj, const char* path, const char* key) {
+    json_obj_t* parent = path != NULL ? json_get_object(obj, path, '.') : obj;
+    json_setting_t* setting = parent != NULL ? json_obj_find(parent, key, strlen(key)) : NULL;
+
+    return setting != NULL ? setting->name : NULL;
+}
+
+int main(void) {
+    json_obj_t* json = json_from_string("{\"a\":{\"name\":1,\"id\":2},\"b\":{\"id\":4,\"n\\u0061me\":3},"
+                                        "\"c\":{\"name\":{\"name\":5}}}");
+    const char* name = name_at(json, "a", "name");
+
+    /* One copy of each key per document, escaped keys included */
+    CHECK(name != NULL && strcmp(name, "name") == 0);
+    CHECK(name_at(json, "b", "name") == name);
+    CHECK(name_at(json, "c", "name") == name);
+    CHECK(name_at(json, "c.name", "name") == name);
+    CHECK(name_at(json, "a", "id") == name_at(json, "b", "id"));
+    CHECK(name_at(json, "a", "id") != name);
+
+    /* Lookups take keys that aren't NUL-terminated, and fail right away on names the document never saw */
+    CHECK(json_obj_find(json_get_object(json, "a", '.'), "name.x", 4) != NULL);
+    CHECK(json_obj_find(json_get_object(json, "a", '.'), "nam", 3) == NULL);
+    CHECK(json_obj_find(json_get_object(json, "a", '.'), "unknown", 7) == NULL);
+    CHECK(json_obj_find(json, "name", 4) == NULL);
+
+    /* Settings added later are interned in the same document */
+    CHECK(json_set_integer(json, "a.extra", '.', 1) == 1);
+    CHECK(json_set_integer(json, "b.extra", '.', 2) == 1);
+    CHECK(name_at(json, "a", "extra") == name_at(json, "b", "extra"));
+    CHECK(json_set_integer(json, "b.name", '.', 6) == 1);
+    CHECK(name_at(json, "b", "name") == name);
+
+    /* Copies get their own document, and keys stay valid after the original is freed */
+    json_obj_t* clone = json_clone(json);
+    json_obj_t* version = json_with_integer(json, "c.name.name", '.', 7);
+    const char* clone_name = name_at(clone, "a", "name");
+
+    CHECK(clone_name != NULL && clone_name != name);
+    CHECK(name_at(clone, "b", "name") == clone_name);
+    CHECK(name_at(clone, "c.name", "name") == clone_name);
+    CHECK(name_at(version, "c.name", "name") == name_at(version, "c", "name"));
+
+    /* An object moved from another document keeps looking up in its own */
+    json_obj_t* other = json_from_string("{\"name\":\"other\",\"only_here\":true}");
+    CHECK(json_set_object(json, "other", '.', other) == 1);
+    CHECK(strcmp(json_get_string(json, "other.name", '.'), "other") == 0);
+    CHECK(json_get_bool(json, "other.only_here", '.') == 1);
+    CHECK(json_obj_find(json, "only_here", 9) == NULL);
+
+    json_free(json);
+    CHECK(json_get_integer(clone, "b.name", '.') == 6);
+    CHECK(json_get_integer(clone, "c.name.name", '.') == 5);
+    CHECK(json_get_integer(version, "c.name.name", '.') == 7);
+    CHECK(json_get_integer(version, "b.name", '.') == 6);
+    CHECK(json_get_integer(version, "a.extra", '.') == 1);
+    json_free(clone);
+    json_free(version);
+
+    /* Members parsed by different workers share the names of the result */
+    char text[4096] = "{";
+    for (int i = 0; i < 64; i++) {
+        snprintf(text + strlen(text), sizeof(text) - strlen(text), "%s\"m%d\":{\"name\":%d}", i > 0 ? "," : "", i, i);
+    }
+    strcat(text, "}");
+
+    json_obj_t* parallel = json_from_string_parallel(text, 4);
+    CHECK(parallel != NULL);
+    name = name_at(parallel, "m0", "name");
+    for (int i = 1; i < 64 && name != NULL; i++) {
+        char member[8];
+
+        snprintf(member, sizeof(member), "m%d", i);
+        CHECK(name_at(parallel, member, "name") == name);
+    }
+    json_free(parallel);
+
+    return TEST_RESULT();
+}
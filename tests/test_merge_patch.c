@@ -0,0 +1,85 @@
+#include "json.h"
+#include "test.h"
+
+/**
+ * Checks whether an object has the content of a JSON text
+ */
+static int content_equals(json_obj_t* obj, const char* text) {
+    json_obj_t* expected = json_from_string(text);
+    char** diff = json_diff(obj, expected, '.');
+    int equal = diff != NULL && diff[0] == NULL;
+
+    json_diff_free(diff);
+    json_free(expected);
+    return equal;
+}
+
+/**
+ * Applies a patch to a target and compares the result with the expected document
+ */
+static int patched_equals(const char* target_text, const char* patch_text, const char* expected_text) {
+    json_obj_t* target = json_from_string(target_text);
+    json_obj_t* patch = json_from_string(patch_text);
+    json_obj_t* expected = json_from_string(expected_text);
+
+    if (target == NULL || patch == NULL || expected == NULL || json_merge_patch(target, patch) == 0) {
+        return 0;
+    }
+
+    char** diff = json_diff(target, expected, '.');
+    int equal = diff != NULL && diff[0] == NULL;
+
+    json_diff_free(diff);
+    json_free(target);
+    json_free(expected);
+    return equal;
+}
+
+int main(void) {
+    /* Examples of RFC 7386, appendix A, without arrays */
+    CHECK(patched_equals("{\"a\":\"b\"}", "{\"a\":\"c\"}", "{\"a\":\"c\"}"));
+    CHECK(patched_equals("{\"a\":\"b\"}", "{\"b\":\"c\"}", "{\"a\":\"b\",\"b\":\"c\"}"));
+    CHECK(patched_equals("{\"a\":\"b\"}", "{\"a\":null}", "{}"));
+    CHECK(patched_equals("{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}", "{\"b\":\"c\"}"));
+    CHECK(patched_equals("{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}", "{\"a\":{\"b\":\"d\"}}"));
+    CHECK(patched_equals("{\"e\":null}", "{\"a\":1}", "{\"e\":null,\"a\":1}"));
+    CHECK(patched_equals("{\"a\":\"foo\"}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}"));
+    CHECK(patched_equals("{}", "{\"a\":{\"bb\":{\"ccc\":null}}}", "{\"a\":{\"bb\":{}}}"));
+
+    /* Objects replaced by values and the other way around, removal of missing keys */
+    CHECK(patched_equals("{\"a\":{\"b\":1}}", "{\"a\":\"x\"}", "{\"a\":\"x\"}"));
+    CHECK(patched_equals("{\"a\":1,\"b\":true}", "{\"a\":{\"c\":2.5},\"z\":null}", "{\"a\":{\"c\":2.5},\"b\":true}"));
+    CHECK(patched_equals("{\"a\":{\"b\":{\"c\":1,\"d\":2}}}", "{\"a\":{\"b\":{\"d\":null,\"e\":3}}}",
+                         "{\"a\":{\"b\":{\"c\":1,\"e\":3}}}"));
+
+    /* A patch is applied, and lookups see the new values */
+    json_obj_t* json = json_from_string("{\"server\":{\"port\":8080,\"legacy\":true}}");
+    CHECK(json_merge_patch(json, json_from_string("{\"server\":{\"port\":8081,\"legacy\":null}}")) == 1);
+    CHECK(json_get_integer(json, "server.port", '.') == 8081);
+    CHECK(json_get_object(json, "server.legacy", '.') == NULL);
+
+    /* Frozen targets are left untouched and the patch isn't consumed */
+    json_obj_t* patch = json_from_string("{\"server\":{\"port\":1}}");
+    CHECK(json_freeze(json) == 1);
+    CHECK(json_merge_patch(json, patch) == 0);
+    CHECK(json_get_integer(json, "server.port", '.') == 8081);
+    CHECK(json_get_integer(patch, "server.port", '.') == 1);
+
+    json_free(patch);
+    json_free(json);
+
+    /* Patches sharing objects with other versions leave them untouched, moved or merged */
+    const char* base_text = "{\"moved\":{\"x\":null,\"y\":{\"z\":null,\"k\":1}},\"merged\":{\"a\":2,\"b\":null}}";
+    json_obj_t* base = json_from_string(base_text);
+    json_obj_t* target = json_from_string("{\"moved\":\"s\",\"merged\":{\"a\":1,\"b\":true,\"c\":3}}");
+
+    patch = json_with_integer(base, "extra", '.', 7);
+    CHECK(patch != NULL);
+    CHECK(json_merge_patch(target, patch) == 1);
+    CHECK(content_equals(target, "{\"moved\":{\"y\":{\"k\":1}},\"merged\":{\"a\":2,\"c\":3},\"extra\":7}"));
+    CHECK(content_equals(base, base_text));
+    json_free(target);
+    json_free(base);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,86 @@
+#include "json.h"
+#include "test.h"
+
+/**
+ * Encodes an object, decodes it back and compares both
+ */
+static int round_trips(const char* text) {
+    json_obj_t* obj = json_from_string(text);
+    char* data = NULL;
+    size_t cap = 0;
+
+    if (obj == NULL) {
+        return 0;
+    }
+
+    size_t len = json_msgpack_encode(obj, &data, &cap);
+    json_obj_t* copy = json_msgpack_decode(data, len);
+    int equal = 0;
+
+    if (copy != NULL) {
+        char** diff = json_diff(obj, copy, '.');
+
+        equal = diff != NULL && diff[0] == NULL;
+        json_diff_free(diff);
+        json_free(copy);
+    }
+
+    json_free_string(data);
+    json_free(obj);
+    return equal;
+}
+
+/**
+ * Decodes bytes, expecting them to be rejected
+ */
+static int rejected(const char* data, size_t len) {
+    json_obj_t* obj = json_msgpack_decode(data, len);
+
+    if (obj != NULL) {
+        json_free(obj);
+        return 0;
+    }
+
+    return 1;
+}
+
+int main(void) {
+    CHECK(round_trips("{}"));
+    CHECK(round_trips("{\"b\":true,\"f\":false,\"n\":null,\"i\":-42,\"big\":9007199254740993,\"d\":2.5}"));
+    CHECK(round_trips("{\"s\":\"caf\\u00e9 \\ud83d\\ude00\",\"e\":\"\",\"q\":\"a\\\"b\\\\c\\n\"}"));
+    CHECK(round_trips("{\"a\":{\"b\":{\"c\":{}},\"d\":\"x\"},\"\\u00e9t\\u00e9\":1}"));
+
+    /* A string of 40 bytes takes the str 8 form */
+    CHECK(round_trips("{\"long\":\"0123456789012345678901234567890123456789\"}"));
+
+    json_obj_t* obj = json_from_string("{\"k\":\"v\",\"o\":{\"x\":1}}");
+    char* data = NULL;
+    size_t cap = 0;
+    size_t len = json_msgpack_encode(obj, &data, &cap);
+
+    /* Every truncation of a valid encoding is rejected */
+    for (size_t i = 0; i < len; i++) {
+        CHECK(rejected(data, i));
+    }
+
+    json_free_string(data);
+    json_free(obj);
+
+    /* Map keys get the checks of string values */
+    CHECK(rejected("\x81\xa1" "a" "\x01", 4) == 0);
+    CHECK(rejected("\x81\xa1" "\x00" "\x01", 4));
+    CHECK(rejected("\x81\xa1" "\xff" "\x01", 4));
+    CHECK(rejected("\x81\xa2" "\xc0\x80" "\x01", 5));
+    CHECK(rejected("\x81\xa3" "\xed\xa0\x80" "\x01", 6));
+    CHECK(rejected("\x81\xa1" "a" "\xa1\x00", 5));
+    CHECK(rejected("\x81\xa1" "a" "\xa2\xc3\x28", 6));
+
+    /* Keys that aren't strings, unsupported values, counts bigger than the data, trailing bytes */
+    CHECK(rejected("\x81\x01\x01", 3));
+    CHECK(rejected("\x81\xa1" "a" "\x91\x01", 5));
+    CHECK(rejected("\x8f\xa1" "a" "\x01", 4));
+    CHECK(rejected("\x81\xa1" "a" "\x01\x01", 5));
+    CHECK(rejected("\x01", 1));
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,70 @@
+#include "json.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static char* read_file(const char* path) {
+    FILE* file = fopen(path, "rb");
+    char* content = calloc(1, 1 << 20);
+
+    if (file != NULL) {
+        fread(content, 1, (1 << 20) - 1, file);
+        fclose(file);
+    }
+
+    return content;
+}
+
+static void check_equivalent(json_obj_t* json) {
+    char* expected = json_dump(json, 0);
+    unsigned int threads[] = { 1, 2, 3, 8, 0 };
+
+    CHECK(json_save(json, "test_parallel_dump.serial.json") == 1);
+    char* serial = read_file("test_parallel_dump.serial.json");
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        char* dump = json_dump_parallel(json, threads[i]);
+
+        CHECK(dump != NULL && strcmp(dump, expected) == 0);
+        json_free_string(dump);
+
+        CHECK(json_save_parallel(json, "test_parallel_dump.parallel.json", threads[i]) == 1);
+        char* parallel = read_file("test_parallel_dump.parallel.json");
+        CHECK(strcmp(parallel, serial) == 0);
+        free(parallel);
+    }
+
+    free(serial);
+    json_free_string(expected);
+    remove("test_parallel_dump.serial.json");
+    remove("test_parallel_dump.parallel.json");
+}
+
+int main(void) {
+    char wide[16384] = "{";
+
+    for (int i = 0; i < 200; i++) {
+        snprintf(wide + strlen(wide), sizeof(wide) - strlen(wide),
+                 "%s\"k%d\":{\"id\":%d,\"name\":\"tab\\t%d\",\"on\":%s,\"ratio\":%d.25}",
+                 i == 0 ? "" : ",", i, i, i, i % 2 ? "true" : "false", i);
+    }
+    strcat(wide, "}");
+
+    json_obj_t* json = json_from_string(wide);
+    CHECK(json != NULL);
+    check_equivalent(json);
+    json_free(json);
+
+    json = json_from_string("{\"a\":{\"b\":{\"c\":\"\\u00e9\"}},\"n\":null}");
+    CHECK(json != NULL);
+    check_equivalent(json);
+    json_free(json);
+
+    json = json_from_string("{}");
+    CHECK(json != NULL);
+    check_equivalent(json);
+    json_free(json);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+/**
+ * Checks that every object of a tree belongs to one document
+ */
+static int same_doc(json_obj_t* obj, json_doc_t* doc) {
+    if (obj->doc != doc) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < obj->settings_count; i++) {
+        json_setting_t* setting = obj->settings[i];
+
+        if (setting->type == Object && setting->obj_type != NULL && !same_doc(setting->obj_type, doc)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void check_equivalent(const char* str) {
+    json_obj_t* serial = json_from_string(str);
+    char* expected = json_dump(serial, 0);
+    unsigned int threads[] = { 1, 2, 3, 8, 0 };
+
+    CHECK(serial != NULL);
+
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        json_obj_t* parallel = json_from_string_parallel(str, threads[i]);
+        char* dump = json_dump(parallel, 0);
+
+        CHECK(parallel != NULL);
+        CHECK(strcmp(dump, expected) == 0);
+        CHECK(same_doc(parallel, parallel->doc));
+
+        json_free_string(dump);
+        json_free(parallel);
+    }
+
+    json_free_string(expected);
+    json_free(serial);
+}
+
+int main(void) {
+    char wide[16384] = "{";
+
+    for (int i = 0; i < 200; i++) {
+        snprintf(wide + strlen(wide), sizeof(wide) - strlen(wide),
+                 "%s\"k%d\":{\"id\":%d,\"name\":\"n\\\"%d\",\"on\":%s,\"deep\":{\"x\":%d.5}}",
+                 i == 0 ? "" : ",", i, i, i, i % 2 ? "true" : "false", i);
+    }
+    strcat(wide, "}");
+
+    /* Many top level members, then few wide ones which are split again */
+    check_equivalent(wide);
+    check_equivalent("{\"a\":{\"x\":1,\"y\":{\"z\":\"deep\"},\"w\":null},\"b\":{\"x\":2}}");
+    check_equivalent("{\"only\":1}");
+    check_equivalent("{}");
+
+    /* Nested objects share the keys interned in the result document */
+    json_obj_t* json = json_from_string_parallel("{\"a\":{\"b\":{\"c\":1}},\"d\":{\"c\":2}}", 4);
+    CHECK(json != NULL);
+    CHECK(json_get_integer(json, "a.b.c", '.') == 1);
+    CHECK(json_get_integer(json, "d.c", '.') == 2);
+    CHECK(json_get_object(json, "a.b", '.')->settings[0]->name == json_get_object(json, "d", '.')->settings[0]->name);
+    CHECK(json_set_integer(json, "a.b.e", '.', 3) == 1);
+    CHECK(json_get_integer(json, "a.b.e", '.') == 3);
+    json_free(json);
+
+    /* Malformed members fail the whole parse */
+    CHECK(json_from_string_parallel("{\"a\":1,\"b\":}", 4) == NULL);
+    CHECK(json_from_string_parallel("{\"a\":{\"b\":\"\\q\"}}", 4) == NULL);
+    CHECK(json_from_string_parallel("not json", 4) == NULL);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,123 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+/**
+ * Settings selected by a run, and after how many the run stops (0 to never stop)
+ */
+typedef struct matches_s {
+    json_setting_t* settings[16];
+    size_t count;
+    size_t stop_after;
+} matches_t;
+
+static int collect(json_setting_t* setting, void* ctx) {
+    matches_t* matches = ctx;
+
+    if (matches->count < 16) {
+        matches->settings[matches->count] = setting;
+    }
+    matches->count++;
+    return matches->stop_after != 0 && matches->count >= matches->stop_after;
+}
+
+/**
+ * Compiles and runs a query, returning the number of selected settings, or -1 if it doesn't compile
+ */
+static long run(const char* text, json_obj_t* obj, matches_t* matches) {
+    json_query_t* query = json_query_compile(text);
+
+    if (query == NULL) {
+        return -1;
+    }
+
+    memset(matches->settings, 0, sizeof(matches->settings));
+    matches->count = 0;
+
+    size_t count = json_query_run(query, obj, collect, matches);
+
+    json_query_free(query);
+    return count == matches->count ? (long)count : -2;
+}
+
+/**
+ * Checks whether a setting with this name was selected
+ */
+static int selected(const matches_t* matches, const char* name) {
+    for (size_t i = 0; i < matches->count && i < 16; i++) {
+        if (strcmp(matches->settings[i]->name, name) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int main(void) {
+    json_obj_t* json = json_from_string("{\"services\":{"
+                                        "\"api\":{\"port\":8080,\"timeout_ms\":100,\"name\":\"api\",\"tls\":true},"
+                                        "\"db\":{\"port\":5432,\"timeout_ms\":500,\"name\":\"db\"},"
+                                        "\"web\":{\"port\":8000.5,\"timeout_ms\":250,\"name\":\"web\",\"tls\":false}},"
+                                        "\"admin\":{\"port\":9000,\"owner\":null},"
+                                        "\"limits\":{\"a\":1,\"b\":5,\"c\":\"5\"}}");
+    matches_t matches = { .stop_after = 0 };
+
+    /* Names, wildcards and the bracket forms */
+    CHECK(run("$.services.*.timeout_ms", json, &matches) == 3);
+    CHECK(run(".services[*].name", json, &matches) == 3);
+    CHECK(run("$['services']['db'].port", json, &matches) == 1);
+    CHECK(matches.settings[0]->long_type == 5432);
+    CHECK(run("$.services.cache.port", json, &matches) == 0);
+
+    /* Descendants at any depth */
+    CHECK(run("$..port", json, &matches) == 4);
+    CHECK(run("$..[*]", json, &matches) > 10);
+
+    /* Filters compare integers and floating numbers together, strings to strings only */
+    CHECK(run("$.services[?(@.port >= 8000)].name", json, &matches) == 2);
+    CHECK(selected(&matches, "name"));
+    CHECK(run("$.services[?(@.port < 8000)]", json, &matches) == 1);
+    CHECK(strcmp(matches.settings[0]->name, "db") == 0);
+    CHECK(run("$.services[?(@.tls)]", json, &matches) == 2);
+    CHECK(run("$.services[?(@.tls == true)]", json, &matches) == 1);
+    CHECK(run("$.services[?(@.name == 'web')].port", json, &matches) == 1);
+    CHECK(run("$.services[?(@.name != \"web\")]", json, &matches) == 2);
+    CHECK(run("$.limits[?(@ == 5)]", json, &matches) == 1);
+    CHECK(strcmp(matches.settings[0]->name, "b") == 0);
+    CHECK(run("$.limits[?(@ != 5)]", json, &matches) == 2);
+    CHECK(run("$.admin[?(@ == null)]", json, &matches) == 1);
+    CHECK(run("$[?(@.owner == null)]", json, &matches) == 1);
+
+    /* The callback stops the run */
+    matches.stop_after = 1;
+    CHECK(run("$..port", json, &matches) == 1);
+    matches.stop_after = 0;
+
+    /* Frozen objects and versions, whose objects belong to other documents */
+    json_obj_t* next = json_with_integer(json, "services.db.port", '.', 8443);
+
+    CHECK(run("$.services[?(@.port >= 8000)]", next, &matches) == 3);
+    CHECK(run("$.services[?(@.port >= 8000)]", json, &matches) == 2);
+    CHECK(run("$.services.db.port", next, &matches) == 1);
+    CHECK(matches.settings[0]->long_type == 8443);
+    json_free(next);
+
+    CHECK(json_freeze(json));
+    CHECK(run("$..timeout_ms", json, &matches) == 3);
+    CHECK(run("$.services[?(@.name == 'db')].port", json, &matches) == 1);
+    CHECK(matches.settings[0]->long_type == 5432);
+
+    /* Invalid queries */
+    CHECK(run("", json, &matches) == -1);
+    CHECK(run("$", json, &matches) == -1);
+    CHECK(run("$.", json, &matches) == -1);
+    CHECK(run("$services", json, &matches) == -1);
+    CHECK(run("$['services'", json, &matches) == -1);
+    CHECK(run("$[?(@.port >)]", json, &matches) == -1);
+    CHECK(run("$[?(port > 1)]", json, &matches) == -1);
+    CHECK(run("$[?(@.port > 1]", json, &matches) == -1);
+
+    json_free(json);
+    return TEST_RESULT();
+}
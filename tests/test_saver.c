@@ -0,0 +1,120 @@
+#include "json.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * Saves reported to on_saved
+ */
+typedef struct saves_s {
+    int count;
+    unsigned long long last_ticket;
+    int last_success;
+} saves_t;
+
+static void on_saved(unsigned long long ticket, int success, void* ctx) {
+    saves_t* saves = ctx;
+
+    __atomic_add_fetch(&saves->count, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&saves->last_ticket, ticket, __ATOMIC_RELAXED);
+    __atomic_store_n(&saves->last_success, success, __ATOMIC_RELAXED);
+}
+
+/**
+ * Reads the integer saved at a key of a file, -1 if the file can't be loaded
+ */
+static long long saved_value(const char* path) {
+    json_obj_t* saved = json_from_file(path);
+
+    if (saved == NULL) {
+        return -1;
+    }
+
+    long long value = json_get_integer(saved, "v", '.');
+
+    json_free(saved);
+    return value;
+}
+
+int main(void) {
+    char dir[] = "/tmp/libjson_saver_XXXXXX";
+    char path[64];
+    char sub_dir[96];
+    char missing[96];
+
+    CHECK(mkdtemp(dir) != NULL);
+    snprintf(path, sizeof(path), "%s/object.json", dir);
+    snprintf(sub_dir, sizeof(sub_dir), "%s/missing", dir);
+    snprintf(missing, sizeof(missing), "%s/missing/object.json", dir);
+
+    json_obj_t* json = json_from_string("{\"v\":0}");
+    saves_t saves = { 0 };
+    json_saver_options_t options = { .min_interval_ms = 300, .on_saved = on_saved, .ctx = &saves };
+    json_saver_t* saver = json_saver_start(json, path, &options);
+
+    CHECK(saver != NULL);
+
+    /* Tickets that weren't issued fail right away, instead of waiting for a save that never comes */
+    CHECK(json_saver_wait(saver, 1) == 0);
+    CHECK(json_saver_wait(saver, 0) == 1);
+
+    json_set_integer(json, "v", '.', 1);
+    unsigned long long first = json_saver_mark_dirty(saver);
+
+    CHECK(first == 1);
+    CHECK(json_saver_wait(saver, first) == 1);
+    CHECK(saved_value(path) == 1);
+    CHECK(json_saver_wait(saver, first + 1) == 0);
+
+    /* Requests made during the minimal interval are coalesced into a single save, covering every ticket */
+    json_set_integer(json, "v", '.', 2);
+    unsigned long long second = json_saver_mark_dirty(saver);
+    json_set_integer(json, "v", '.', 3);
+    unsigned long long third = json_saver_mark_dirty(saver);
+
+    CHECK(second == first + 1 && third == second + 1);
+    CHECK(json_saver_wait(saver, third) == 1);
+    CHECK(json_saver_wait(saver, second) == 1);
+    CHECK(saved_value(path) == 3);
+    CHECK(__atomic_load_n(&saves.count, __ATOMIC_RELAXED) == 2);
+    CHECK(__atomic_load_n(&saves.last_ticket, __ATOMIC_RELAXED) == third);
+    CHECK(__atomic_load_n(&saves.last_success, __ATOMIC_RELAXED) == 1);
+
+    /* Stopping writes the pending changes */
+    json_set_integer(json, "v", '.', 4);
+    json_saver_mark_dirty(saver);
+    CHECK(json_saver_stop(saver) == 1);
+    CHECK(saved_value(path) == 4);
+
+    /* A failed save is reported to waiters */
+    saver = json_saver_start(json, missing, NULL);
+    CHECK(saver != NULL);
+    unsigned long long failed = json_saver_mark_dirty(saver);
+    CHECK(json_saver_wait(saver, failed) == 0);
+
+    /* A later successful save covers the failed ticket, a failure doesn't change the result of earlier tickets */
+    CHECK(mkdir(sub_dir, 0700) == 0);
+    unsigned long long succeeded = json_saver_mark_dirty(saver);
+    CHECK(json_saver_wait(saver, succeeded) == 1);
+    CHECK(json_saver_wait(saver, failed) == 1);
+    CHECK(remove(missing) == 0 && rmdir(sub_dir) == 0);
+    CHECK(json_saver_wait(saver, json_saver_mark_dirty(saver)) == 0);
+    CHECK(json_saver_wait(saver, succeeded) == 1);
+    CHECK(json_saver_stop(saver) == 0);
+
+    /* The saver doesn't make a sub-object look shared, writes through its parent are still saved */
+    json_obj_t* root = json_from_string("{\"sub\":{\"v\":5}}");
+    saver = json_saver_start(json_get_object(root, "sub", '.'), path, NULL);
+    CHECK(json_set_integer(root, "sub.v", '.', 6) == 1);
+    CHECK(json_saver_wait(saver, json_saver_mark_dirty(saver)) == 1);
+    CHECK(saved_value(path) == 6);
+    CHECK(json_saver_stop(saver) == 1);
+    json_free(root);
+
+    json_free(json);
+    remove(path);
+    rmdir(dir);
+    return TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+/**
+ * Events received by the trace callback
+ */
+typedef struct traces_s {
+    int parses;
+    int dumps;
+    int misses;
+    char missed[32];
+} traces_t;
+
+static void on_trace(const json_trace_t* event, void* ctx) {
+    traces_t* traces = ctx;
+
+    switch (event->type) {
+        case TraceParse: traces->parses++; break;
+        case TraceDump: traces->dumps++; break;
+        case TraceLookupMiss:
+            traces->misses++;
+            strncpy(traces->missed, event->key, sizeof(traces->missed) - 1);
+            break;
+    }
+}
+
+int main(void) {
+    const char* text = "{\"name\":\"libjson\",\"server\":{\"port\":8080}}";
+    traces_t traces = { 0 };
+    json_stats_t global;
+    json_stats_t stats;
+
+    json_set_trace(on_trace, &traces);
+
+    json_obj_t* json = json_from_string(text);
+    int enabled = json_get_stats(json, &stats);
+
+    CHECK(json_get_integer(json, "server.port", '.') == 8080);
+    CHECK(json_get_string(json, "missing", '.') == NULL);
+    char* dump = json_dump(json, 0);
+    CHECK(json_get_stats(json, &stats) == enabled);
+    CHECK(json_get_stats(NULL, &global) == enabled);
+
+    if (enabled == 0) {
+        /* Without JSON_STATS every counter stays zero and nothing is traced */
+        json_stats_t zero = { 0 };
+        CHECK(memcmp(&stats, &zero, sizeof(zero)) == 0);
+        CHECK(memcmp(&global, &zero, sizeof(zero)) == 0);
+        CHECK(traces.parses == 0 && traces.dumps == 0 && traces.misses == 0);
+    } else {
+        /* Parses, dumps and lookups of the document */
+        CHECK(stats.parse_count == 1 && stats.parse_bytes == strlen(text));
+        CHECK(stats.dump_count == 1 && stats.dump_bytes == strlen(dump));
+        CHECK(stats.lookups == 2 && stats.lookup_depth == 3 && stats.lookup_misses == 1);
+
+        /* Allocations of the document, its memory stays alive until it's freed */
+        CHECK(stats.allocations > 0 && stats.allocated_bytes >= strlen(text));
+        CHECK(stats.live_bytes > 0 && stats.live_bytes <= stats.allocated_bytes);
+        CHECK(stats.frees < stats.allocations);
+
+        /* The global statistics include every document and temporary allocations */
+        CHECK(global.parse_count >= stats.parse_count && global.allocations >= stats.allocations);
+        CHECK(global.lookups >= stats.lookups && global.lookup_misses >= stats.lookup_misses);
+
+        CHECK(traces.parses == 1 && traces.dumps == 1 && traces.misses == 1);
+        CHECK(strcmp(traces.missed, "missing") == 0);
+    }
+
+    /* Freeing the document and the dump releases everything allocated through the library */
+    json_free_string(dump);
+    json_free(json);
+    json_set_trace(NULL, NULL);
+    CHECK(json_get_stats(NULL, &global) == enabled);
+    CHECK(global.live_bytes == 0);
+    CHECK(global.allocations == global.frees);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,68 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+/**
+ * Checks the keys of an object, in order
+ */
+static int keys_are(json_obj_t* obj, const char* const* keys, size_t count) {
+    if (obj->settings_count != count) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(obj->settings[i]->name, keys[i]) != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int main(void) {
+    json_obj_t* json = json_from_string("{\"a\":1,\"b\":\"two\",\"c\":{\"x\":true,\"y\":null},\"d\":2.5}");
+    const char* const all[] = { "a", "b", "c", "d" };
+    const char* const without_b[] = { "a", "c", "d" };
+    const char* const appended[] = { "a", "c", "d", "b" };
+
+    /* Updates keep the position of the setting, whatever the new type */
+    CHECK(json_set_string(json, "a", '.', "one") == 1);
+    CHECK(json_set_integer(json, "b", '.', 2) == 1);
+    CHECK(json_set_bool(json, "c.x", '.', 0) == 1);
+    CHECK(json_set_floating(json, "d", '.', 3.5) == 1);
+    CHECK(keys_are(json, all, 4));
+    CHECK(strcmp(json_get_string(json, "a", '.'), "one") == 0);
+    CHECK(json_get_integer(json, "b", '.') == 2);
+
+    /* Removals keep the order of the remaining settings, new settings are appended */
+    CHECK(json_remove_setting(json, "b", '.') == 1);
+    CHECK(keys_are(json, without_b, 3));
+    CHECK(json_set_string(json, "b", '.', "back") == 1);
+    CHECK(keys_are(json, appended, 4));
+
+    /* Strings of the same length or shorter are written into the existing buffer */
+    char* buffer = json_get_string(json, "b", '.');
+    CHECK(json_set_string(json, "b", '.', "same") == 1);
+    CHECK(json_get_string(json, "b", '.') == buffer);
+    CHECK(json_set_string(json, "b", '.', "s") == 1);
+    CHECK(json_get_string(json, "b", '.') == buffer);
+    CHECK(strcmp(buffer, "s") == 0);
+
+    /* The buffer keeps its capacity after a shorter string, a longer one gets a new buffer */
+    CHECK(json_set_string(json, "b", '.', "four") == 1);
+    CHECK(json_get_string(json, "b", '.') == buffer);
+    CHECK(json_set_string(json, "b", '.', "a longer string") == 1);
+    CHECK(strcmp(json_get_string(json, "b", '.'), "a longer string") == 0);
+    CHECK(keys_are(json, appended, 4));
+
+    /* Parsed strings with escapes are reused too, their buffer is at least as long as the decoded string */
+    json_obj_t* escaped = json_from_string("{\"s\":\"\\u00e9\\n\"}");
+    buffer = json_get_string(escaped, "s", '.');
+    CHECK(json_set_string(escaped, "s", '.', "abc") == 1);
+    CHECK(json_get_string(escaped, "s", '.') == buffer);
+    json_free(escaped);
+
+    json_free(json);
+    return TEST_RESULT();
+}
@@ -0,0 +1,59 @@
+#include "json.h"
+#include "test.h"
+
+#include <string.h>
+
+int main(void) {
+    json_obj_t* v1 = json_from_string("{\"a\":{\"x\":1,\"s\":\"one\"},\"b\":{\"y\":2}}");
+    json_obj_t* v2 = json_with_integer(v1, "b.y", '.', 3);
+
+    /* Only the path is copied, into a document of its own */
+    CHECK(v2 != NULL);
+    CHECK(v2->doc != v1->doc);
+    CHECK(json_get_object(v1, "a", '.') == json_get_object(v2, "a", '.'));
+    CHECK(json_get_integer(v1, "b.y", '.') == 2);
+    CHECK(json_get_integer(v2, "b.y", '.') == 3);
+
+    /* Modifying a version in place copies what it shares first */
+    CHECK(json_set_integer(v2, "a.x", '.', 99));
+    CHECK(json_set_string(v2, "a.new", '.', "two"));
+    CHECK(json_get_integer(v1, "a.x", '.') == 1);
+    CHECK(json_get_integer(v2, "a.x", '.') == 99);
+    CHECK(json_get_object(v1, "a.new", '.') == NULL);
+    CHECK(strcmp(json_get_string(v2, "a.new", '.'), "two") == 0);
+    CHECK(json_get_object(v1, "a", '.') != json_get_object(v2, "a", '.'));
+
+    json_obj_t* v3 = json_without(v2, "a.s", '.');
+
+    CHECK(v3 != NULL);
+    CHECK(json_remove_setting(v2, "a.x", '.'));
+    CHECK(json_get_integer(v3, "a.x", '.') == 99);
+    CHECK(strcmp(json_get_string(v2, "a.s", '.'), "one") == 0);
+    CHECK(json_get_object(v3, "a.s", '.') == NULL);
+
+    json_obj_t* v4 = json_with_bool(v1, "b.on", '.', 1);
+    json_obj_t* patch = json_from_string("{\"a\":{\"x\":5,\"s\":null}}");
+
+    CHECK(json_merge_patch(v4, patch));
+    CHECK(json_get_integer(v4, "a.x", '.') == 5);
+    CHECK(json_get_integer(v1, "a.x", '.') == 1);
+    CHECK(strcmp(json_get_string(v1, "a.s", '.'), "one") == 0);
+
+    /* A clone shares nothing, and outlives its original */
+    json_obj_t* clone = json_clone(v1);
+
+    CHECK(clone->doc != v1->doc);
+    CHECK(json_get_object(clone, "a", '.') != json_get_object(v1, "a", '.'));
+    CHECK(json_set_integer(clone, "a.x", '.', 7));
+    CHECK(json_get_integer(v1, "a.x", '.') == 1);
+
+    json_free(v1);
+    json_free(v2);
+    json_free(v3);
+    json_free(v4);
+    CHECK(json_get_integer(clone, "a.x", '.') == 7);
+    CHECK(strcmp(json_get_string(clone, "a.s", '.'), "one") == 0);
+    json_free(clone);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,83 @@
+#include "json.h"
+#include "test.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int reloads = 0;
+static int errors = 0;
+
+static void on_reload(json_obj_t* obj, void* ctx) {
+    (void)obj;
+    (void)ctx;
+    __atomic_add_fetch(&reloads, 1, __ATOMIC_RELAXED);
+}
+
+static void on_error(const char* message, void* ctx) {
+    (void)message;
+    (void)ctx;
+    __atomic_add_fetch(&errors, 1, __ATOMIC_RELAXED);
+}
+
+static void write_file(const char* path, const char* content) {
+    FILE* file = fopen(path, "w");
+
+    fputs(content, file);
+    fclose(file);
+}
+
+int main(void) {
+    char dir[] = "/tmp/libjson_watch_XXXXXX";
+    char path[64];
+    char other[64];
+
+    CHECK(mkdtemp(dir) != NULL);
+    snprintf(path, sizeof(path), "%s/config.json", dir);
+    snprintf(other, sizeof(other), "%s/other.log", dir);
+    write_file(path, "{\"version\":1}");
+
+    json_watch_t* watch = json_watch(path, 100, on_reload, on_error, NULL);
+    CHECK(watch != NULL);
+
+    int initial = __atomic_load_n(&reloads, __ATOMIC_RELAXED);
+    json_obj_t* current = json_watch_acquire(watch);
+    CHECK(current != NULL && json_get_integer(current, "version", '.') == 1);
+    json_watch_release(watch, current);
+
+    /* Another file of the directory keeps changing: the reload must not be postponed by it */
+    write_file(path, "{\"version\":2}");
+    for (int i = 0; i < 100 && __atomic_load_n(&reloads, __ATOMIC_RELAXED) == initial; i++) {
+        write_file(other, "busy");
+        usleep(20000);
+    }
+    CHECK(__atomic_load_n(&reloads, __ATOMIC_RELAXED) == initial + 1);
+
+    current = json_watch_acquire(watch);
+    CHECK(current != NULL && json_get_integer(current, "version", '.') == 2);
+    json_watch_release(watch, current);
+
+    /* Rewriting the same content doesn't publish a new version */
+    write_file(path, "{ \"version\" : 2 }");
+    usleep(400000);
+    CHECK(__atomic_load_n(&reloads, __ATOMIC_RELAXED) == initial + 1);
+
+    /* Invalid content is reported and the current version stays published */
+    CHECK(__atomic_load_n(&errors, __ATOMIC_RELAXED) == 0);
+    write_file(path, "{\"version\":");
+    for (int i = 0; i < 100 && __atomic_load_n(&errors, __ATOMIC_RELAXED) == 0; i++) {
+        usleep(20000);
+    }
+    CHECK(__atomic_load_n(&errors, __ATOMIC_RELAXED) > 0);
+    CHECK(__atomic_load_n(&reloads, __ATOMIC_RELAXED) == initial + 1);
+
+    current = json_watch_acquire(watch);
+    CHECK(current != NULL && json_get_integer(current, "version", '.') == 2);
+    json_watch_release(watch, current);
+
+    json_watch_stop(watch);
+    remove(path);
+    remove(other);
+    rmdir(dir);
+    return TEST_RESULT();
+}